@@ -1,15 +1,36 @@
-layout (location = 0) out vec3 g_pos;
-layout (location = 1) out vec3 g_norm;
-layout (location = 2) out vec3 g_col;
+layout (location = 0) out vec4 g_col;
 
 in vec3 f_map_pos;
-in vec2 f_tex_pos;
-in vec3 f_norm;
+flat in int   f_norm;
+flat in float f_tex;
 
-uniform sampler2D tileset;
+uniform sampler2DArray tileset;
+
+//@NOTE has to match FrameUniforms in src/rendering.hpp
+layout (std140) uniform Frame {
+    mat4  mvp;
+    mat4  inv_mvp;
+    vec4  ambient_light;
+    float time;
+};
 
 void main() {
-    g_pos = f_map_pos;
-    g_norm = f_norm;
-    g_col = texture(tileset, f_tex_pos).rgb;
+    //@NOTE the uv is taken per fragment, so that merged quads repeat the
+    //texture for every block they cover
+    vec2 uv;
+    int n_a = f_norm >> 1;
+    if(n_a == 0) {
+        uv = f_map_pos.yz;
+    } else if(n_a == 1) {
+        uv = f_map_pos.xz;
+    } else {
+        uv = f_map_pos.xy;
+    }
+    //@NOTE the gradients are taken before fract, otherwise the mip level
+    //would jump at every block edge
+    g_col.rgb = textureGrad(tileset, vec3(fract(uv), f_tex),
+                            dFdx(uv), dFdy(uv)).rgb;
+    //@NOTE the face orientation is stored instead of the normal, the position
+    //is rebuilt from depth in map_deferred.frag
+    g_col.a   = float(f_norm) / 255.;
 }
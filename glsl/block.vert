@@ -3,29 +3,28 @@ layout (location = 1) in float norm;
 layout (location = 2) in float tex;
 
 out vec3 f_map_pos;
-out vec2 f_tex_pos;
-out vec3 f_norm;
+flat out int f_norm;
+flat out float f_tex;
 
-uniform vec3 chk_pos;
-uniform vec2 tex_scale;
-uniform mat4 mvp;
+uniform samplerBuffer pages;
+uniform int  page_verts;
+
+//@NOTE has to match FrameUniforms in src/rendering.hpp
+layout (std140) uniform Frame {
+    mat4  mvp;
+    mat4  inv_mvp;
+    vec4  ambient_light;
+    float time;
+};
 
 void main()
 {
+    //@NOTE gl_VertexID includes the base vertex, so it points into the
+    //geometry arena, whose page table holds the chunk translation
+    vec3 chk_pos = texelFetch(pages, gl_VertexID / page_verts).xyz;
     vec3 map_pos = pos + chk_pos;
     gl_Position  = mvp * vec4(map_pos, 1.0);
-    f_norm = vec3(0.);
-    int n_a = (int(norm) & 6) >> 1;
-    f_norm[n_a] = 1.;
-    if((int(norm) & 1) == 0) f_norm *= -1.;
-    vec2 uv;
-    //if(n_a == 0) {
-    //    uv = map_pos.yz;
-    //} else if(n_a == 1) {
-    //    uv = map_pos.xz;
-    //} else if(n_a == 2) {
-        uv = map_pos.xy;
-    //}
-    f_tex_pos = (vec2(tex, 0.0) + fract(uv)) * tex_scale;
+    f_norm    = int(norm) & 7;
+    f_tex     = tex;
     f_map_pos = map_pos;
 }
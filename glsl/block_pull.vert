@@ -0,0 +1,38 @@
+out vec3 f_map_pos;
+flat out int f_norm;
+flat out float f_tex;
+
+uniform usamplerBuffer faces;
+uniform int  quad_idxs[6];
+uniform vec3 chk_pos;
+
+//@NOTE has to match FrameUniforms in src/rendering.hpp
+layout (std140) uniform Frame {
+    mat4  mvp;
+    mat4  inv_mvp;
+    vec4  ambient_light;
+    float time;
+};
+
+//@NOTE rebuilds the quad corners of the face records written by pack_face in
+//src/map.cpp, every face is drawn as 6 vertices
+void main()
+{
+    uint face = texelFetch(faces, gl_VertexID / 6).r;
+    int  norm = int((face >> 15) & 7u);
+    int  n_a  = norm >> 1;
+    int  quad_idx = gl_VertexID % 6;
+    if((norm & 1) == 0) quad_idx = 5 - quad_idx;
+    int  corner = quad_idxs[quad_idx];
+
+    vec3 pos = vec3(face & 31u, (face >> 5) & 31u, (face >> 10) & 31u);
+    pos[n_a] += 1.;
+    pos[(n_a + 1) % 3] += float(corner & 1);
+    pos[(n_a + 2) % 3] += float(corner >> 1);
+
+    vec3 map_pos = pos + chk_pos;
+    gl_Position  = mvp * vec4(map_pos, 1.0);
+    f_norm    = norm;
+    f_tex     = float(face >> 18);
+    f_map_pos = map_pos;
+}
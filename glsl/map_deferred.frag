@@ -2,16 +2,35 @@ out vec4 o_col;
 
 in vec2 f_tex_pos;
 
-uniform sampler2D g_pos;
-uniform sampler2D g_norm;
 uniform sampler2D g_col;
+uniform sampler2D g_depth;
+///the part of the G-buffer that was rendered to
+uniform vec2      g_scale;
+
+//@NOTE has to match FrameUniforms in src/rendering.hpp
+layout (std140) uniform Frame {
+    mat4  mvp;
+    mat4  inv_mvp;
+    vec4  ambient_light;
+    float time;
+};
 
 void main() {
+    vec2  g_pos = f_tex_pos * g_scale;
+    vec4  col   = texture(g_col, g_pos);
+    float depth = texture(g_depth, g_pos).r;
+    if(depth == 1.0) {
+        o_col = vec4(col.rgb, 1.0);
+        return;
+    }
+    vec4 ndc_pos = vec4(vec3(f_tex_pos, depth) * 2.0 - 1.0, 1.0);
+    vec4 map_pos = inv_mvp * ndc_pos;
+    vec3 pos     = map_pos.xyz / map_pos.w;
 
-    vec3 pos  = texture(g_pos, f_tex_pos).xyz;
-    vec3 norm = texture(g_norm, f_tex_pos).xyz;
-    vec3 col  = texture(g_col, f_tex_pos).rgb;
+    int  face = int(col.a * 255. + 0.5);
+    vec3 norm = vec3(0.);
+    norm[face >> 1] = (face & 1) == 0 ? -1. : 1.;
     float n = max(dot(norm, normalize(vec3(1000., 2000., 3000.) - pos)), 0.0) *
         0.7 + 0.3;
-    o_col = vec4(col * n, 1.0);
+    o_col = vec4(col.rgb * n, 1.0);
 }
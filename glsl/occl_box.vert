@@ -0,0 +1,18 @@
+uniform vec3 box_min;
+uniform vec3 box_max;
+
+//@NOTE has to match FrameUniforms in src/rendering.hpp
+layout (std140) uniform Frame {
+    mat4  mvp;
+    mat4  inv_mvp;
+    vec4  ambient_light;
+    float time;
+};
+
+void main()
+{
+    //@NOTE builds the 14 vertex triangle strip of a cube from the vertex id
+    int b = 1 << gl_VertexID;
+    vec3 corner = vec3((0x287a & b) != 0, (0x02af & b) != 0, (0x31e3 & b) != 0);
+    gl_Position = mvp * vec4(mix(box_min, box_max, corner), 1.0);
+}
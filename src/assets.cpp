@@ -0,0 +1,145 @@
+#include <cstring>
+#include <fstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+//
+#include <lodepng/lodepng.h>
+//
+#include <lux_shared/common.hpp>
+//
+#include "assets.hpp"
+
+struct Asset {
+    char const*     path;
+    bool            should_decode;
+    bool            is_ready = false;
+    bool            is_taken = false;
+    bool            is_ok    = false;
+    ///the file contents or the decoded RGBA pixels
+    std::vector<U8> data;
+    Vec2U           size;
+};
+
+static struct {
+    std::thread             thread;
+    std::mutex              mutex;
+    std::condition_variable cond;
+    ///a deque, so that the worker can keep a reference while more assets are
+    ///queued
+    std::deque<Asset>       assets;
+    SizeT                   next_idx    = 0;
+    bool                    should_stop = false;
+} loader;
+
+static bool read_file(char const* path, std::vector<U8>& data) {
+    std::ifstream file(path, std::ios::binary);
+    if(not file.is_open()) return false;
+    file.seekg(0, file.end);
+    long len = file.tellg();
+    if(len < 0) return false;
+    file.seekg(0, file.beg);
+    data.resize(len);
+    file.read((char*)data.data(), len);
+    return file.good();
+}
+
+static bool decode_png(std::vector<U8> const& png,
+                       std::vector<U8>& img, Vec2U& size) {
+    Vec2<unsigned> png_size;
+    if(lodepng::decode(img, png_size.x, png_size.y, png) != 0) return false;
+    size = png_size;
+    return true;
+}
+
+static void load_asset(Asset& asset) {
+    asset.is_ok = read_file(asset.path, asset.data);
+    if(asset.is_ok && asset.should_decode) {
+        std::vector<U8> png = move(asset.data);
+        asset.is_ok = decode_png(png, asset.data, asset.size);
+    }
+}
+
+static void loader_worker() {
+    while(true) {
+        Asset* asset;
+        {   std::unique_lock<std::mutex> lock(loader.mutex);
+            loader.cond.wait(lock, [] {
+                return loader.should_stop ||
+                       loader.next_idx < loader.assets.size();
+            });
+            if(loader.should_stop) return;
+            asset = &loader.assets[loader.next_idx++];
+        }
+        load_asset(*asset);
+        {   std::lock_guard<std::mutex> lock(loader.mutex);
+            asset->is_ready = true;
+        }
+        loader.cond.notify_all();
+    }
+}
+
+void assets_init() {
+    loader.thread = std::thread(&loader_worker);
+}
+
+void assets_deinit() {
+    {   std::lock_guard<std::mutex> lock(loader.mutex);
+        loader.should_stop = true;
+    }
+    loader.cond.notify_all();
+    loader.thread.join();
+    loader.assets.clear();
+    loader.next_idx = 0;
+}
+
+void asset_preload(char const* path, bool should_decode) {
+    {   std::lock_guard<std::mutex> lock(loader.mutex);
+        Asset asset;
+        asset.path          = path;
+        asset.should_decode = should_decode;
+        loader.assets.emplace_back(move(asset));
+    }
+    loader.cond.notify_all();
+}
+
+///returns false if the asset wasn't preloaded
+static bool take_asset(char const* path, bool should_decode, Asset& out) {
+    std::unique_lock<std::mutex> lock(loader.mutex);
+    Asset* asset = nullptr;
+    for(auto& it : loader.assets) {
+        if(not it.is_taken && it.should_decode == should_decode &&
+           std::strcmp(it.path, path) == 0) {
+            asset = &it;
+            break;
+        }
+    }
+    if(asset == nullptr) return false;
+    loader.cond.wait(lock, [&] { return asset->is_ready; });
+    asset->is_taken = true;
+    out.is_ok = asset->is_ok;
+    out.data  = move(asset->data);
+    out.size  = asset->size;
+    return true;
+}
+
+bool asset_take_file(char const* path, std::vector<U8>& data) {
+    Asset asset;
+    if(not take_asset(path, false, asset)) {
+        return read_file(path, data);
+    }
+    data = move(asset.data);
+    return asset.is_ok;
+}
+
+bool asset_take_png(char const* path, std::vector<U8>& img, Vec2U& size) {
+    Asset asset;
+    if(not take_asset(path, true, asset)) {
+        std::vector<U8> png;
+        return read_file(path, png) && decode_png(png, img, size);
+    }
+    img  = move(asset.data);
+    size = asset.size;
+    return asset.is_ok;
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <vector>
+//
+#include <lux_shared/common.hpp>
+
+///asset files are read, and PNGs decoded, on a worker thread while the window
+///and the GL context are being created, only the GL uploads are left for the
+///main thread, preloading is just a hint, assets that weren't preloaded are
+///loaded synchronously when taken
+
+void assets_init();
+void assets_deinit();
+void asset_preload(char const* path, bool should_decode);
+///these wait for the asset if it's still being loaded, the preloaded data is
+///moved out, so every asset can be taken once
+bool asset_take_file(char const* path, std::vector<U8>& data);
+bool asset_take_png(char const* path, std::vector<U8>& img, Vec2U& size);
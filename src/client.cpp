@@ -24,9 +24,43 @@ struct {
 
     StrBuff server_name  = "unnamed"_l;
     bool    should_close = false;
-    VecSet<ChkPos> sent_requests;
 } static client;
 
+static constexpr SizeT NET_SAMPLES_NUM        = 128;
+///bytes sent and received per tick
+static struct {
+    U32 rx_sum = 0;
+    U32 tx_sum = 0;
+    U32 count  = 0;
+    U32 rx_max = 0;
+    U32 tx_max = 0;
+    U32 rx_avg = 0;
+    U32 tx_avg = 0;
+} net_stats;
+
+static constexpr SizeT MAX_REQUESTS_IN_FLIGHT = 64;
+///in seconds
+static constexpr F64   REQUEST_TIMEOUT        = 5.0;
+
+///chunk requests sent to the server and not answered yet
+static struct {
+    struct Request {
+        ChkPos pos;
+        F64    time;
+    };
+    DynArr<Request> in_flight;
+    U64 sent_num      = 0;
+    U64 timeouts_num  = 0;
+    U64 cancelled_num = 0;
+
+    Int find(ChkPos const& pos) const {
+        for(Uns i = 0; i < in_flight.len; ++i) {
+            if(in_flight[i].pos == pos) return i;
+        }
+        return -1;
+    }
+} requests;
+
 EntityVec last_player_pos = {0, 0, 0};
 F64 tick_rate = 0.f;
 
@@ -45,6 +79,10 @@ bool client_should_close() {
     return client.should_close;
 }
 
+Str client_server_name() {
+    return (Str)client.server_name;
+}
+
 static void get_user_name(char* buff) {
     constexpr char unknown[] = "unknown";
     static_assert(sizeof(unknown) - 1 <= CLIENT_NAME_LEN);
@@ -236,7 +274,8 @@ LUX_MAY_FAIL static handle_signal(ENetPacket* in_pack) {
             case NetSsSgnl::CHUNK_LOAD: {
                 map_load_chunks(ss_sgnl.chunk_load);
                 for(auto const& chunk : ss_sgnl.chunk_load.chunks) {
-                    client.sent_requests.erase(chunk.first);
+                    Int idx = requests.find(chunk.first);
+                    if(idx >= 0) requests.in_flight.erase(idx, 1);
                 }
             } break;
             case NetSsSgnl::CHUNK_UPDATE: {
@@ -281,14 +320,33 @@ LUX_MAY_FAIL client_tick(GLFWwindow* glfw_window) {
         LUX_LOG_WARN("lost server tick");
     }
     ///send map request signal
-    {   cs_sgnl.tag = NetCsSgnl::MAP_REQUEST;
-        for(auto const& pos : chunk_requests) {
-            if(client.sent_requests.count(pos) == 0) {
-                cs_sgnl.map_request.requests.emplace(pos);
-                client.sent_requests.emplace(pos);
+    {   F64 now = glfwGetTime();
+        //@NOTE requests which timed out are dropped, so that they are sent
+        //again if the chunk is still wanted, requests for chunks that left the
+        //load range are cancelled
+        //@TODO the protocol has no unload signal, so the server still sends
+        //cancelled chunks, which map_load_chunks ignores
+        for(Uns i = 0; i < requests.in_flight.len;) {
+            auto const& request = requests.in_flight[i];
+            if(now - request.time > REQUEST_TIMEOUT) {
+                requests.timeouts_num++;
+            } else if(not map_is_chunk_wanted(request.pos)) {
+                requests.cancelled_num++;
+            } else {
+                ++i;
+                continue;
             }
+            requests.in_flight.erase(i, 1);
+        }
+        cs_sgnl.tag = NetCsSgnl::MAP_REQUEST;
+        cs_sgnl.map_request.requests.clear();
+        for(auto const& pos : chunk_requests) {
+            if(requests.in_flight.len >= MAX_REQUESTS_IN_FLIGHT) break;
+            if(requests.find(pos) >= 0) continue;
+            cs_sgnl.map_request.requests.emplace(pos);
+            requests.in_flight.push({pos, now});
+            requests.sent_num++;
         }
-        chunk_requests.clear();
         if(cs_sgnl.map_request.requests.size() > 0) {
             LUX_RETHROW(send_net_data(client.peer, &cs_sgnl, SGNL_CHANNEL),
                 "failed to send map requests");
@@ -297,39 +355,43 @@ LUX_MAY_FAIL client_tick(GLFWwindow* glfw_window) {
     if(send_net_data(client.peer, &cs_tick, TICK_CHANNEL) != LUX_OK) {
         LUX_LOG("failed to send tick");
     }
-    SizeT constexpr samples_num = 128;
-    static U32 rx_sum = 0;
-    static U32 tx_sum = 0;
-    static U32 count  = 0;
-    static U32 rx_max = 0;
-    static U32 tx_max = 0;
-    static U32 rx_avg = 0;
-    static U32 tx_avg = 0;
-    U32 rx = client.host->totalReceivedData;
-    U32 tx = client.host->totalSentData;
-    rx_max = max(rx_max, rx);
-    tx_max = max(tx_max, tx);
-    rx_sum += rx;
-    tx_sum += rx;
-    count++;
-    if(count >= samples_num) {
-        rx_avg = round((F64)rx_sum / (F64)count);
-        tx_avg = round((F64)tx_sum / (F64)count);
-        rx_sum = 0;
-        tx_sum = 0;
-        rx_max = 0;
-        tx_max = 0;
-        count  = 0;
+    {   auto& stats = net_stats;
+        U32 rx = client.host->totalReceivedData;
+        U32 tx = client.host->totalSentData;
+        stats.rx_max = max(stats.rx_max, rx);
+        stats.tx_max = max(stats.tx_max, tx);
+        stats.rx_sum += rx;
+        stats.tx_sum += rx;
+        stats.count++;
+        if(stats.count >= NET_SAMPLES_NUM) {
+            stats.rx_avg = round((F64)stats.rx_sum / (F64)stats.count);
+            stats.tx_avg = round((F64)stats.tx_sum / (F64)stats.count);
+            stats.rx_sum = 0;
+            stats.tx_sum = 0;
+            stats.rx_max = 0;
+            stats.tx_max = 0;
+            stats.count  = 0;
+        }
     }
-    ImGui::Begin("network status");
-    ImGui::Text("(%zu tick avg.)", samples_num);
-    ImGui::Text("tx: %uB", tx_avg);
-    ImGui::Text("rx: %uB", rx_avg);
-    ImGui::Text("(%zu tick max)", samples_num);
-    ImGui::Text("tx: %uB", tx_max);
-    ImGui::Text("rx: %uB", rx_max);
-    ImGui::End();
     client.host->totalReceivedData = 0;
     client.host->totalSentData = 0;
     return LUX_OK;
 }
+
+///the network status is drawn every frame, while the numbers are only
+///updated on ticks
+void client_imgui() {
+    ImGui::Begin("network status");
+    ImGui::Text("(%zu tick avg.)", NET_SAMPLES_NUM);
+    ImGui::Text("tx: %uB", net_stats.tx_avg);
+    ImGui::Text("rx: %uB", net_stats.rx_avg);
+    ImGui::Text("(%zu tick max)", NET_SAMPLES_NUM);
+    ImGui::Text("tx: %uB", net_stats.tx_max);
+    ImGui::Text("rx: %uB", net_stats.rx_max);
+    ImGui::Text("chunk requests in flight: %zu/%zu",
+                requests.in_flight.len, MAX_REQUESTS_IN_FLIGHT);
+    ImGui::Text("chunk requests sent: %zu", requests.sent_num);
+    ImGui::Text("chunk requests timed out: %zu", requests.timeouts_num);
+    ImGui::Text("chunk requests cancelled: %zu", requests.cancelled_num);
+    ImGui::End();
+}
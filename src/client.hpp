@@ -15,5 +15,7 @@ extern NetSsSgnl ss_sgnl;
 LUX_MAY_FAIL client_init(char const* server_hostname, U16 server_port);
 void client_deinit();
 LUX_MAY_FAIL client_tick(GLFWwindow* glfw_window);
+void client_imgui();
 void client_quit();
 bool client_should_close();
+Str client_server_name();
@@ -0,0 +1,396 @@
+#if defined(LUX_OS_UNIX)
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+#endif
+#include <cerrno>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+//
+#include <lux_shared/common.hpp>
+#include <lux_shared/map.hpp>
+//
+#include <map.hpp>
+#include "disk_cache.hpp"
+
+///every region file holds a cube of REGION_SIZE^3 chunks, the header maps
+///every chunk to its slot of records, a rewritten chunk reuses its slot if it
+///fits, otherwise it's appended and the old slot becomes dead space, which is
+///reclaimed by compacting the file
+ChkCoord constexpr REGION_SIZE     = 8;
+SizeT    constexpr REGION_CHUNKS   = REGION_SIZE * REGION_SIZE * REGION_SIZE;
+U32      constexpr REGION_MAGIC    = 0x4352584c; ///"LXRC"
+U32      constexpr REGION_VERSION  = 2;
+///the file is compacted once the dead space is above this and above the
+///live data
+SizeT    constexpr REGION_COMPACT_MIN_DEAD = 256 * 1024;
+///the least recently used region is closed once more are open, so that a
+///long session doesn't run out of file descriptors or address space
+SizeT    constexpr REGIONS_MAX = 64;
+
+struct RegionEntry {
+    U32 off;
+    U32 records_num;
+    ///in records, the slot can be bigger than the records in it
+    U32 capacity;
+    U32 reserved;
+    U64 hash;
+};
+
+struct RegionHeader {
+    U32         magic;
+    U32         version;
+    RegionEntry entries[REGION_CHUNKS];
+};
+
+struct Region {
+    int   fd       = -1;
+    U8*   map      = nullptr;
+    SizeT map_len  = 0;
+    SizeT file_len = 0;
+    ///bytes of the slots which aren't referenced anymore
+    SizeT dead_len = 0;
+    U64   last_use = 0;
+};
+
+static struct {
+    bool    is_enabled = false;
+    char    dir_path[128];
+    std::unordered_map<ChkPos, Region, ChkPosHash> regions;
+    U64     uses_num = 0;
+} disk_cache;
+
+U64 disk_cache_hash(DynArr<U32> const& records) {
+    ///FNV-1a
+    U64 hash = 0xcbf29ce484222325;
+    U8 const* bytes = (U8 const*)records.beg;
+    for(SizeT i = 0; i < records.len * sizeof(U32); ++i) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3;
+    }
+    return hash;
+}
+
+#if defined(LUX_OS_UNIX)
+static ChkCoord floor_div(ChkCoord a, ChkCoord b) {
+    return a >= 0 ? a / b : (a - b + 1) / b;
+}
+
+static void region_unmap(Region& region) {
+    if(region.map != nullptr) {
+        munmap(region.map, region.map_len);
+        region.map     = nullptr;
+        region.map_len = 0;
+    }
+}
+
+///maps the whole file, the mapping has to be renewed after the file grows
+static bool region_map(Region& region) {
+    if(region.map != nullptr && region.map_len == region.file_len) return true;
+    region_unmap(region);
+    void* map = mmap(nullptr, region.file_len, PROT_READ, MAP_SHARED,
+                     region.fd, 0);
+    if(map == MAP_FAILED) {
+        LUX_LOG_WARN("failed to map region file: %s", std::strerror(errno));
+        return false;
+    }
+    region.map     = (U8*)map;
+    region.map_len = region.file_len;
+    return true;
+}
+
+static void get_region_path(ChkPos const& region_pos, char* path, SizeT len) {
+    std::snprintf(path, len, "%s/%zd_%zd_%zd.region", disk_cache.dir_path,
+                  region_pos.x, region_pos.y, region_pos.z);
+}
+
+static bool write_empty_header(int fd) {
+    static RegionHeader empty_header;
+    std::memset(&empty_header, 0, sizeof(empty_header));
+    empty_header.magic   = REGION_MAGIC;
+    empty_header.version = REGION_VERSION;
+    return ftruncate(fd, 0) == 0 &&
+           pwrite(fd, &empty_header, sizeof(empty_header), 0) ==
+               (ssize_t)sizeof(empty_header);
+}
+
+///returns nullptr if the region file couldn't be opened
+static void region_close(Region& region) {
+    if(region.fd < 0) return;
+    region_unmap(region);
+    close(region.fd);
+    region.fd = -1;
+}
+
+///makes room for one more region
+static void evict_regions() {
+    while(disk_cache.regions.size() >= REGIONS_MAX) {
+        auto lru_it = disk_cache.regions.begin();
+        for(auto it = lru_it; it != disk_cache.regions.end(); ++it) {
+            if(it->second.last_use < lru_it->second.last_use) lru_it = it;
+        }
+        region_close(lru_it->second);
+        disk_cache.regions.erase(lru_it);
+    }
+}
+
+static Region* get_region(ChkPos const& region_pos, bool should_create) {
+    auto it = disk_cache.regions.find(region_pos);
+    if(it != disk_cache.regions.end()) {
+        if(it->second.fd >= 0 || not should_create) {
+            it->second.last_use = ++disk_cache.uses_num;
+            return &it->second;
+        }
+        disk_cache.regions.erase(it);
+    }
+    evict_regions();
+
+    char path[512];
+    get_region_path(region_pos, path, sizeof(path));
+    int fd = open(path, should_create ? O_RDWR | O_CREAT : O_RDWR, 0644);
+    if(fd < 0) {
+        //@NOTE remembered, so that we don't retry on every lookup
+        if(not should_create) {
+            Region& region = disk_cache.regions[region_pos];
+            region.last_use = ++disk_cache.uses_num;
+            return &region;
+        }
+        return nullptr;
+    }
+    struct stat st;
+    if(fstat(fd, &st) != 0) {
+        close(fd);
+        return nullptr;
+    }
+    Region region;
+    region.fd       = fd;
+    region.file_len = st.st_size;
+    bool is_compatible = false;
+    if(region.file_len >= sizeof(RegionHeader)) {
+        RegionHeader header;
+        is_compatible =
+            pread(fd, &header, 2 * sizeof(U32), 0) ==
+                (ssize_t)(2 * sizeof(U32)) &&
+            header.magic == REGION_MAGIC && header.version == REGION_VERSION;
+    }
+    if(not is_compatible) {
+        //@NOTE a new, truncated or outdated file, it's only a cache, so we
+        //start over with an empty header
+        if(region.file_len > 0) {
+            LUX_LOG_WARN("discarding incompatible region file %s", path);
+        }
+        if(not write_empty_header(fd)) {
+            close(fd);
+            return nullptr;
+        }
+        region.file_len = sizeof(RegionHeader);
+    }
+    if(not region_map(region)) {
+        close(fd);
+        return nullptr;
+    }
+    auto const* header = (RegionHeader const*)region.map;
+    SizeT live_len = sizeof(RegionHeader);
+    for(auto const& entry : header->entries) {
+        if(entry.off != 0) live_len += (SizeT)entry.capacity * sizeof(U32);
+    }
+    region.dead_len = region.file_len > live_len ?
+        region.file_len - live_len : 0;
+    region.last_use = ++disk_cache.uses_num;
+    return &(disk_cache.regions[region_pos] = region);
+}
+
+///rewrites the live slots into a new file, which then replaces the old one,
+///so that a crash can't leave a half written region behind, the entry at
+///skip_idx is dropped, because it's about to be rewritten
+static bool region_compact(Region& region, ChkPos const& region_pos,
+                           SizeT skip_idx) {
+    if(not region_map(region)) return false;
+    char path[512];
+    char tmp_path[520];
+    get_region_path(region_pos, path, sizeof(path));
+    std::snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    int fd = open(tmp_path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if(fd < 0) return false;
+
+    static RegionHeader header;
+    std::memcpy(&header, region.map, sizeof(header));
+    SizeT off = sizeof(RegionHeader);
+    bool is_ok = true;
+    for(SizeT i = 0; i < REGION_CHUNKS && is_ok; ++i) {
+        auto& entry = header.entries[i];
+        if(entry.off == 0) continue;
+        if(i == skip_idx) {
+            entry = {};
+            continue;
+        }
+        SizeT len = (SizeT)entry.records_num * sizeof(U32);
+        is_ok = (SizeT)entry.off + len <= region.map_len &&
+                pwrite(fd, region.map + entry.off, len, off) == (ssize_t)len;
+        entry.off      = off;
+        entry.capacity = entry.records_num;
+        off += len;
+    }
+    is_ok = is_ok &&
+        pwrite(fd, &header, sizeof(header), 0) == (ssize_t)sizeof(header) &&
+        rename(tmp_path, path) == 0;
+    if(not is_ok) {
+        LUX_LOG_WARN("failed to compact region file %s", path);
+        close(fd);
+        unlink(tmp_path);
+        return false;
+    }
+    LUX_LOG("compacted region file %s from %zuKiB to %zuKiB",
+            path, region.file_len / 1024, off / 1024);
+    region_close(region);
+    region.fd       = fd;
+    region.file_len = off;
+    region.dead_len = 0;
+    return true;
+}
+
+static void get_region_pos(ChkPos const& pos,
+                           ChkPos& region_pos, SizeT& entry_idx) {
+    region_pos = {floor_div(pos.x, REGION_SIZE),
+                  floor_div(pos.y, REGION_SIZE),
+                  floor_div(pos.z, REGION_SIZE)};
+    ChkPos local = pos - region_pos * REGION_SIZE;
+    entry_idx = local.x +
+                local.y * REGION_SIZE +
+                local.z * REGION_SIZE * REGION_SIZE;
+}
+
+void disk_cache_init(Str const& server_name) {
+    //@NOTE the server name comes from the network, so we don't let it
+    //escape the cache directory
+    char dir_name[64];
+    SizeT dir_name_len = 0;
+    for(SizeT i = 0; i < server_name.len && i < sizeof(dir_name) - 1; ++i) {
+        char c = server_name.beg[i];
+        bool is_safe = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+                       (c >= '0' && c <= '9') || c == '-' || c == '_';
+        dir_name[dir_name_len++] = is_safe ? c : '_';
+    }
+    dir_name[dir_name_len] = '\0';
+    if(dir_name_len == 0) std::strcpy(dir_name, "unnamed");
+
+    char* path = disk_cache.dir_path;
+    std::snprintf(path, sizeof(disk_cache.dir_path), "chunk_cache/%s",
+                  dir_name);
+    if((mkdir("chunk_cache", 0755) != 0 && errno != EEXIST) ||
+       (mkdir(path, 0755) != 0 && errno != EEXIST)) {
+        LUX_LOG_WARN("failed to create chunk cache directory %s: %s",
+                     path, std::strerror(errno));
+        return;
+    }
+    disk_cache.is_enabled = true;
+    LUX_LOG("using chunk cache directory %s", path);
+}
+
+void disk_cache_deinit() {
+    for(auto& pair : disk_cache.regions) {
+        region_close(pair.second);
+    }
+    disk_cache.regions.clear();
+    disk_cache.is_enabled = false;
+}
+
+bool disk_cache_read(ChkPos const& pos, DynArr<U32>& records, U64& hash) {
+    if(not disk_cache.is_enabled) return false;
+    ChkPos region_pos;
+    SizeT  entry_idx;
+    get_region_pos(pos, region_pos, entry_idx);
+    Region* region = get_region(region_pos, false);
+    if(region == nullptr || region->fd < 0 || not region_map(*region)) {
+        return false;
+    }
+    auto const& entry = ((RegionHeader const*)region->map)->entries[entry_idx];
+    if(entry.off == 0) return false;
+    if((SizeT)entry.off + (SizeT)entry.records_num * sizeof(U32) >
+       region->map_len) {
+        LUX_LOG_WARN("chunk {%zd, %zd, %zd} is out of its region file",
+                     pos.x, pos.y, pos.z);
+        return false;
+    }
+    records.resize(entry.records_num);
+    std::memcpy(records.beg, region->map + entry.off,
+                records.len * sizeof(U32));
+    hash = entry.hash;
+    return true;
+}
+
+void disk_cache_write(ChkPos const& pos, DynArr<U32> const& records,
+                      U64 hash) {
+    if(not disk_cache.is_enabled) return;
+    ChkPos region_pos;
+    SizeT  entry_idx;
+    get_region_pos(pos, region_pos, entry_idx);
+    Region* region = get_region(region_pos, true);
+    if(region == nullptr) {
+        LUX_LOG_WARN("failed to open region file for chunk {%zd, %zd, %zd}",
+                     pos.x, pos.y, pos.z);
+        return;
+    }
+    if(not region_map(*region)) return;
+    RegionEntry entry =
+        ((RegionHeader const*)region->map)->entries[entry_idx];
+    SizeT data_len = records.len * sizeof(U32);
+    SizeT entry_off = offsetof(RegionHeader, entries) +
+                      entry_idx * sizeof(RegionEntry);
+    if(entry.off != 0 && records.len <= entry.capacity) {
+        //@NOTE the entry is dropped before its slot gets overwritten, so that
+        //an interrupted write can't pair the old hash with the new records
+        RegionEntry empty_entry = {};
+        if(pwrite(region->fd, &empty_entry, sizeof(empty_entry), entry_off) !=
+               (ssize_t)sizeof(empty_entry)) {
+            return;
+        }
+    } else {
+        if(entry.off != 0) {
+            region->dead_len += (SizeT)entry.capacity * sizeof(U32);
+        }
+        if(region->dead_len > REGION_COMPACT_MIN_DEAD &&
+           region->dead_len * 2 > region->file_len) {
+            region_compact(*region, region_pos, entry_idx);
+        }
+        //@NOTE offsets are 32-bit, a region can't hold more than 4GiB
+        if(region->file_len + data_len > std::numeric_limits<U32>::max()) {
+            LUX_LOG_WARN("region file is full, can't cache chunk "
+                         "{%zd, %zd, %zd}", pos.x, pos.y, pos.z);
+            return;
+        }
+        entry.off      = region->file_len;
+        entry.capacity = records.len;
+    }
+    entry.records_num = records.len;
+    entry.reserved    = 0;
+    entry.hash        = hash;
+    if(pwrite(region->fd, records.beg, data_len, entry.off) !=
+           (ssize_t)data_len ||
+       pwrite(region->fd, &entry, sizeof(entry), entry_off) !=
+           (ssize_t)sizeof(entry)) {
+        LUX_LOG_WARN("failed to write chunk {%zd, %zd, %zd} to region file",
+                     pos.x, pos.y, pos.z);
+        return;
+    }
+    if(entry.off + data_len > region->file_len) {
+        region->file_len = entry.off + data_len;
+    }
+}
+#else
+void disk_cache_init(Str const&) {
+    LUX_LOG_WARN("chunk cache is not supported on this platform");
+}
+
+void disk_cache_deinit() {}
+
+bool disk_cache_read(ChkPos const&, DynArr<U32>&, U64&) {
+    return false;
+}
+
+void disk_cache_write(ChkPos const&, DynArr<U32> const&, U64) {}
+#endif
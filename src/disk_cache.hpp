@@ -0,0 +1,15 @@
+#pragma once
+
+#include <lux_shared/common.hpp>
+#include <lux_shared/map.hpp>
+
+///persistent cache of the chunks received from a server, chunks are stored as
+///packed face records in memory-mapped region files, so that they can be drawn
+///right after joining while the server sends the fresh ones
+
+void disk_cache_init(Str const& server_name);
+void disk_cache_deinit();
+///returns false if the chunk isn't cached
+bool disk_cache_read(ChkPos const& pos, DynArr<U32>& records, U64& hash);
+void disk_cache_write(ChkPos const& pos, DynArr<U32> const& records, U64 hash);
+U64  disk_cache_hash(DynArr<U32> const& records);
@@ -1,5 +1,4 @@
-#include <glm/gtc/type_ptr.hpp>
-//
+#include <assets.hpp>
 #include <db.hpp>
 #include <rendering.hpp>
 #include <client.hpp>
@@ -11,8 +10,9 @@ static EntityComps comps;
 EntityComps& entity_comps = comps;
 DynArr<EntityId> entities;
 
-static GLuint program;
-static GLuint tileset;
+static gl::Program program;
+static GLuint      program_id;
+static GLuint      tileset;
 
 #pragma pack(push, 1)
 struct Vert {
@@ -28,10 +28,20 @@ static gl::VertFmt     vert_fmt;
 
 static void entity_io_tick(U32, Transform const&, IoContext&);
 
+void entity_preload() {
+    asset_preload("entity_tileset.png", true);
+    asset_preload("glsl/entity.vert"  , false);
+    asset_preload("glsl/entity.frag"  , false);
+}
+
+void entity_start_programs() {
+    program_id = load_program("glsl/entity.vert", "glsl/entity.frag");
+}
+
 void entity_init() {
     constexpr Vec2U tile_sz = {8, 8};
     char const* tileset_path = "entity_tileset.png";
-    program = load_program("glsl/entity.vert", "glsl/entity.frag");
+    program.init(program_id);
 
     vert_fmt.init(
         {{2, GL_FLOAT        , false, false},
@@ -39,9 +49,8 @@ void entity_init() {
     Vec2U tileset_sz;
     tileset = load_texture(tileset_path, tileset_sz);
     Vec2F tex_scale = (Vec2F)tile_sz / (Vec2F)tileset_sz;
-    glUseProgram(program);
-    set_uniform("tex_scale", program, glUniform2fv, 1,
-                glm::value_ptr(tex_scale));
+    program.use();
+    program.get_uniform<Vec2F>("tex_scale").set(tex_scale);
 
     v_buff.init();
     i_buff.init();
@@ -53,11 +62,9 @@ void entity_init() {
 static void entity_io_tick(U32, Transform const& tr, IoContext&) {
     /*glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    glUseProgram(program);
-    set_uniform("scale", program, glUniform2fv,
-                1, glm::value_ptr(tr.scale));
-    set_uniform("translation", program, glUniform2fv,
-                1, glm::value_ptr(tr.pos));
+    program.use();
+    program.get_uniform<Vec2F>("scale").set(tr.scale);
+    program.get_uniform<Vec2F>("translation").set(tr.pos);
 
     static DynArr<U32>  idxs;
     static DynArr<Vert> verts;
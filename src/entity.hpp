@@ -24,5 +24,7 @@ struct EntityComps {
 
 extern EntityComps& entity_comps;
 extern DynArr<EntityId> entities;
+void entity_preload();
+void entity_start_programs();
 void entity_init();
 void set_net_entity_comps(NetSsTick::EntityComps const& net_comps);
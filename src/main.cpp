@@ -1,6 +1,8 @@
 #include <cstdlib>
 #include <cmath>
 #include <cstring>
+#include <thread>
+#include <chrono>
 //
 #include <enet/enet.h>
 #include <imgui/imgui.h>
@@ -8,8 +10,8 @@
 #include <imgui/imgui_impl_glfw.h>
 //
 #include <lux_shared/common.hpp>
-#include <lux_shared/util/tick_clock.hpp>
 //
+#include <assets.hpp>
 #include <db.hpp>
 #include <map.hpp>
 #include <rendering.hpp>
@@ -19,6 +21,9 @@
 
 struct {
     Vec2U window_size = {800, 600};
+    bool  vsync       = true;
+    ///0 for no cap
+    F64   max_fps     = 0.0;
 } conf;
 
 void scroll_cb(GLFWwindow* window, F64 d_x, F64 d_y) {
@@ -34,11 +39,16 @@ void mouse_button_cb(GLFWwindow* window, int button, int action, int mods) {
 void window_resize_cb(GLFWwindow*, int win_w, int win_h) {
     static Vec2U old_sz = {1.f, 1.f};
     LUX_LOG("window size change to %ux%u", win_w, win_h);
-    glViewport(0, 0, win_w, win_h);
     ui_window_sz_cb(old_sz, {win_w, win_h});
     old_sz = {win_w, win_h};
 }
 
+///the framebuffer size differs from the window size on high-DPI displays
+void framebuffer_resize_cb(GLFWwindow*, int fb_w, int fb_h) {
+    glViewport(0, 0, fb_w, fb_h);
+    map_framebuffer_sz_cb({fb_w, fb_h});
+}
+
 void key_cb(GLFWwindow* window, int key, int scancode, int action, int mods) {
     ImGui_ImplGlfw_KeyCallback(window, key, scancode, action, mods);
     ui_key(key, action);
@@ -70,18 +80,37 @@ int main(int argc, char** argv) {
         }
     }
 
-    if(client_init(server_hostname, server_port) != LUX_OK) {
-        LUX_FATAL("failed to initialize client");
-    }
-    LUX_DEFER { client_deinit(); };
+    assets_init();
+    LUX_DEFER { assets_deinit(); };
+    ui_preload();
+    map_preload();
+    entity_preload();
+    ///the handshake waits on the server, so it runs while the window and the
+    ///GL context are created, it only touches the client state until joined
+    bool is_client_ok = false;
+    std::thread client_thread([&] {
+        is_client_ok = client_init(server_hostname, server_port) == LUX_OK;
+    });
     db_init();
     rendering_init();
     LUX_DEFER { rendering_deinit(); };
+    ///every compilation is started before the first program is needed
+    ui_start_programs();
+    map_start_programs();
+    entity_start_programs();
     ui_init();
     map_init();
+    LUX_DEFER { map_deinit(); };
     entity_init();
+    client_thread.join();
+    if(not is_client_ok) {
+        LUX_FATAL("failed to initialize client");
+    }
+    LUX_DEFER { client_deinit(); };
+    map_set_server(client_server_name());
     check_opengl_error();
     glfwSetWindowSizeCallback(glfw_window, window_resize_cb);
+    glfwSetFramebufferSizeCallback(glfw_window, framebuffer_resize_cb);
     glfwSetMouseButtonCallback(glfw_window, mouse_button_cb);
     glfwSetScrollCallback(glfw_window, scroll_cb);
     glfwSetKeyCallback(glfw_window, key_cb);
@@ -93,19 +122,37 @@ int main(int argc, char** argv) {
     Vec2<int> win_size;
     glfwGetWindowSize(glfw_window, &win_size.x, &win_size.y);
     window_resize_cb(glfw_window, win_size.x, win_size.y);
+    Vec2<int> fb_size;
+    glfwGetFramebufferSize(glfw_window, &fb_size.x, &fb_size.y);
+    framebuffer_resize_cb(glfw_window, fb_size.x, fb_size.y);
     { ///main loop
-        auto tick_len = util::TickClock::Duration(1.0 / tick_rate);
-        util::TickClock clock(tick_len);
+        //@NOTE the network ticks at the server tick rate, while frames are
+        //drawn as often as vsync and the frame cap allow, so any number of
+        //frames can happen between two ticks
+        F64 const tick_len  = 1.0 / tick_rate;
+        F64 const frame_len = conf.max_fps > 0.0 ? 1.0 / conf.max_fps : 0.0;
+        F64 next_tick  = glfwGetTime();
+        F64 next_frame = next_tick;
+        glfwSwapInterval(conf.vsync ? 1 : 0);
         while(!client_should_close()) {
-            clock.start();
             ImGui_ImplOpenGL3_NewFrame();
             ImGui_ImplGlfw_NewFrame();
             ImGui::NewFrame();
             glfwPollEvents();
 
-            if(client_tick(glfw_window) != LUX_OK) {
-                LUX_FATAL("game state corrupted");
+            F64 now = glfwGetTime();
+            if(now >= next_tick) {
+                if(client_tick(glfw_window) != LUX_OK) {
+                    LUX_FATAL("game state corrupted");
+                }
+                next_tick += tick_len;
+                ///we don't try to catch up on the missed ticks
+                if(next_tick <= now) {
+                    LUX_LOG("tick overhead of %.4fs", now - next_tick);
+                    next_tick = now + tick_len;
+                }
             }
+            client_imgui();
             /*if(entity_comps.container.count(ss_tick.player_id) > 0) {
                 F32 off = 0.f;
                 for(auto const& item : entity_comps.container.at(ss_tick.player_id).items) {
@@ -126,10 +173,15 @@ int main(int argc, char** argv) {
             check_opengl_error();
             glfwSwapBuffers(glfw_window);
 
-            clock.stop();
-            auto remaining = clock.synchronize();
-            if(remaining < util::TickClock::Duration::zero()) {
-                LUX_LOG("tick overhead of %.4fs", std::abs(remaining.count()));
+            if(frame_len > 0.0) {
+                next_frame += frame_len;
+                F64 remaining = next_frame - glfwGetTime();
+                if(remaining > 0.0) {
+                    std::this_thread::sleep_for(
+                        std::chrono::duration<F64>(remaining));
+                } else {
+                    next_frame = glfwGetTime();
+                }
             }
         }
     }
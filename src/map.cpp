@@ -1,9 +1,20 @@
 #include <cstring>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <initializer_list>
+#ifdef __SSE2__
+    #include <emmintrin.h>
+#endif
 //
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
-#include <glm/gtc/type_ptr.hpp>
-#include <glm/gtx/fast_square_root.hpp>
+#include <glm/gtc/matrix_access.hpp>
 //
 #include <lux_shared/common.hpp>
 #include <lux_shared/map.hpp>
@@ -13,13 +24,104 @@
 #include <rendering.hpp>
 #include <db.hpp>
 #include <client.hpp>
+#include <disk_cache.hpp>
+#include <assets.hpp>
 #include <ui.hpp>
 #include "map.hpp"
 
 static UiId        ui_map;
 static gl::VertFmt vert_fmt;
-static GLuint      program;
+static gl::Program program;
+///GL_TEXTURE_2D_ARRAY, the mesh tex is the layer
 static GLuint      tileset;
+///vertex pulling renders the meshes straight from their face records
+static gl::Program pull_program;
+static GLuint      pull_context;
+///GPU culling writes the indirect draw commands in glsl/chunk_cull.comp
+static gl::Program cull_program;
+static gl::Program occl_program;
+///set by map_start_programs, the programs are initialized from them in
+///map_init
+static struct {
+    GLuint block    = 0;
+    GLuint pull     = 0;
+    GLuint cull     = 0;
+    GLuint occl     = 0;
+    GLuint deferred = 0;
+} program_ids;
+///mvp and the other frame constants come from the Frame uniform
+///block, only the per draw uniforms are set through these
+static struct {
+    gl::Uniform<Vec3F> pull_chk_pos;
+    gl::Uniform<Vec4F> cull_planes;
+    gl::Uniform<Vec3F> cull_cam_chk_pos;
+    gl::Uniform<F32>   cull_render_dist;
+    gl::Uniform<U32>   cull_slots_num;
+    gl::Uniform<Vec3F> occl_box_min;
+    gl::Uniform<Vec3F> occl_box_max;
+    gl::Uniform<Vec2F> deferred_g_scale;
+} uniforms;
+
+struct MeshFace {
+    ChkIdx  idx;
+    U8      orientation;
+    BlockId id;
+};
+
+///all the chunk meshes share a single index buffer, since their indices only
+///repeat quad_idxs, the winding is handled by the vertex order instead
+static gl::IdxBuff quad_i_buff;
+static SizeT       quad_i_buff_len = 0;
+
+///chunk geometry is suballocated in pages from a few large vertex buffers,
+///every page is mapped to the translation of its chunk through a page table,
+///which lets glsl/block.vert find the chunk from gl_VertexID, so all the
+///chunks of an arena are drawn with a single multi draw
+SizeT constexpr ARENA_PAGE_VERTS = 256;
+SizeT constexpr ARENA_PAGES_NUM  = 4096;
+
+struct ArenaAlloc {
+    U32 arena;
+    U32 page;
+    U32 pages_num = 0;
+};
+
+///std430 layout of a chunk in glsl/chunk_cull.comp
+struct CullChunk {
+    Vec4F box_min;
+    Vec4F box_max;
+    Vec4F pos;
+    U32   idxs_num;
+    I32   base_vert;
+    U32   pad[2];
+};
+static_assert(sizeof(CullChunk) == 64, "CullChunk must match std430 layout");
+
+struct GeomArena {
+    struct Span {
+        U32 page;
+        U32 pages_num;
+    };
+    gl::VertBuff    v_buff;
+    gl::VertContext context;
+    gl::Buff        pages_buff;
+    GLuint          pages_tex;
+    ///sorted by page, adjacent spans are always merged
+    DynArr<Span>    free_spans;
+
+    DynArr<GLsizei>     draw_counts;
+    DynArr<void const*> draw_offs;
+    DynArr<GLint>       draw_base_verts;
+
+    ///GPU culling, every page has a chunk slot and an indirect draw command,
+    ///a chunk uses the slot of its first page and the rest stay empty
+    gl::Buff        chunks_buff;
+    gl::Buff        cmds_buff;
+};
+
+static DynArr<GeomArena> arenas;
+
+static void arena_free(ArenaAlloc& alloc);
 
 struct Mesh {
 #pragma pack(push, 1)
@@ -30,35 +132,98 @@ struct Mesh {
     };
 #pragma pack(pop)
 
+    ///holds the packed face records of pulled meshes
     gl::VertBuff v_buff;
-    gl::IdxBuff i_buff;
-    gl::VertContext context;
+    GLuint       faces_tex;
+    ///location of the verts in the geometry arenas
+    ArenaAlloc   geom;
+    ///every 4 verts form a quad, indexed by the shared quad_i_buff
     DynArr<Vert> verts;
-    DynArr<U16>  idxs;
+    ///server-ordered faces, kept for rebuilding and updating the mesh
+    DynArr<MeshFace> faces;
+    ///quad slot of every server-ordered face, removed faces leave degenerate
+    ///quads behind which are reused by the added ones, so that updates don't
+    ///have to move the verts, unused for greedy meshes
+    DynArr<U32>      quad_slots;
+    DynArr<U32>      free_quads;
+    ///quads changed since the last upload
+    DynArr<U32>      dirty_quads;
+    ///bounds of the faces, in blocks relative to the chunk
+    Vec3<U8>         box_min;
+    Vec3<U8>         box_max;
+    ///for every side of the chunk, the mask of sides that can be seen through
+    ///it, sides are indexed like face orientations
+    Arr<U8, 6>       side_links;
+    ///occlusion query of the bounding box, its result is used in the next
+    ///frame, so that we don't stall on it
+    GLuint occl_query;
+    bool   is_occl_pending = false;
+    bool   is_occluded     = false;
+    ///the frame of the last query, older results aren't trusted
+    U64    occl_frame      = 0;
+    ///hash of the face records the server sent us last
+    U64    faces_hash;
+    ///restored from the disk cache and not confirmed by the server yet
+    bool   is_stale      = false;
+    ///changed since it was last written to the disk cache
+    bool   is_disk_dirty = false;
+    ///id of the mesher job the mesh is waiting for, 0 if it is built
+    U64  job_id = 0;
+    ///greedy meshes don't map faces to quads 1:1, so they can't be updated
+    ///in place
+    bool is_greedy = false;
+    ///the mesh is downsampled by 2^lod, only whole-resolution meshes can be
+    ///updated in place
+    U8   lod = 0;
+    bool is_pulled = false;
     bool is_allocated = false;
 
     void alloc() {
         LUX_ASSERT(not is_allocated);
         v_buff.init();
-        i_buff.init();
-        context.init({v_buff}, vert_fmt);
+        glGenTextures(1, &faces_tex);
+        glGenQueries(1, &occl_query);
+        is_occl_pending = false;
+        is_occluded     = false;
+        occl_frame      = 0;
+        is_stale        = false;
+        is_disk_dirty   = false;
         is_allocated = true;
     }
 
     void dealloc() {
         LUX_ASSERT(is_allocated);
-        context.deinit();
-        i_buff.deinit();
+        glDeleteTextures(1, &faces_tex);
+        glDeleteQueries(1, &occl_query);
         v_buff.deinit();
+        arena_free(geom);
         is_allocated = false;
     }
 
     void operator=(Mesh&& that) {
         v_buff  = move(that.v_buff);
-        i_buff  = move(that.i_buff);
-        context = move(that.context);
+        faces_tex = that.faces_tex;
+        geom    = that.geom;
+        that.geom.pages_num = 0;
         verts   = move(that.verts);
-        idxs    = move(that.idxs);
+        faces   = move(that.faces);
+        quad_slots = move(that.quad_slots);
+        free_quads = move(that.free_quads);
+        dirty_quads = move(that.dirty_quads);
+        box_min = that.box_min;
+        box_max = that.box_max;
+        side_links = that.side_links;
+        occl_query = that.occl_query;
+        is_occl_pending = that.is_occl_pending;
+        is_occluded     = that.is_occluded;
+        occl_frame      = that.occl_frame;
+        faces_hash      = that.faces_hash;
+        is_stale        = that.is_stale;
+        is_disk_dirty   = that.is_disk_dirty;
+        job_id  = that.job_id;
+        is_greedy = that.is_greedy;
+        lod       = that.lod;
+        is_pulled = that.is_pulled;
         is_allocated = move(that.is_allocated);
         that.is_allocated = false;
     }
@@ -79,37 +244,1159 @@ struct Renderer {
     gl::VertFmt     vert_fmt;
     gl::VertContext context;
 
+    ///the map position is reconstructed from g_depth, g_col holds the block
+    ///color and the face orientation in alpha
     GLuint g_buff;
-    GLuint g_pos;
-    GLuint g_norm;
     GLuint g_col;
-    GLuint rbo;
+    GLuint g_depth;
+    ///follows the framebuffer size of the window
+    Vec2U  g_buff_sz = {0, 0};
 
-    GLuint program;
+    gl::Program program;
 } static renderer;
 
 static Mesh debug_mesh_0;
 static Mesh debug_mesh_1;
 
 static DynArr<Mesh>   meshes;
-VecSet<ChkPos>        chunk_requests;
+DynArr<ChkPos>        chunk_requests;
+///chunks updated since the last frame
+static VecSet<ChkPos> pending_updates;
+
+///face expansion runs on worker threads, only the buffer upload is done on the
+///GL thread, see mesher_integrate
+struct MeshJob {
+    ChkPos pos;
+    U64    id;
+    bool   greedy;
+    U8     lod;
+    DynArr<MeshFace> faces;
+};
+
+struct MeshResult {
+    ChkPos pos;
+    U64    id;
+    bool   greedy;
+    U8     lod;
+    DynArr<Mesh::Vert> verts;
+    Arr<U8, 6>         side_links;
+};
+
+static struct {
+    std::vector<std::thread> threads;
+    std::mutex               jobs_mutex;
+    std::condition_variable  jobs_cond;
+    std::deque<MeshJob>      jobs;
+    std::mutex               results_mutex;
+    std::deque<MeshResult>   results;
+    bool                     should_stop = false;
+    U64                      last_job_id = 0;
+} mesher;
 
 static ChkCoord render_dist = 2;
+//@NOTE greedy meshes can't be patched in place by map_update_chunks, every
+//edit rebuilds and re-uploads the whole chunk, so it's off by default
+static bool     greedy_meshing = false;
+static bool     vertex_pulling = false;
+static bool     gpu_culling    = false;
+static bool     occlusion_culling = true;
+static bool     occlusion_queries = false;
+static bool     lod_enabled = true;
+static int      lod_dist    = 8;
+static U8 constexpr LOD_MAX = 3;
 static ChkPos   last_player_chk_pos = to_chk_pos(glm::floor(last_player_pos));
 
+///the map is rendered into a corner of the G-buffer, which is scaled to keep
+///the GPU time of the map pass near the target, the lighting pass upscales it
+static F32 constexpr DYN_RES_MIN_SCALE = 0.5f;
+static struct {
+    bool   is_enabled = true;
+    F32    scale      = 1.f;
+    F32    target_ms  = 12.f;
+    F32    last_ms    = 0.f;
+    GLuint query      = 0;
+    bool   is_pending = false;
+} dyn_res;
+
 static void map_io_tick(  U32, Transform const&, IoContext&);
 
+static Arr<Vec3<U8>, 3 * 4> const vert_offs = {
+    {0, 0, 0}, {0, 1, 0}, {0, 0, 1}, {0, 1, 1},
+    {0, 0, 0}, {0, 0, 1}, {1, 0, 0}, {1, 0, 1},
+    {0, 0, 0}, {1, 0, 0}, {0, 1, 0}, {1, 1, 0},
+};
+
+///scale stretches the quad along the two axes of the face plane
+static void build_quad(Mesh::Vert* verts, MeshFace const& face,
+                       Vec3<U8> const& scale) {
+    U8 axis = (face.orientation & 0b110) >> 1;
+    LUX_ASSERT(axis != 0b11);
+    U8 sign = (face.orientation & 1);
+    Vec3<U8> face_off(0);
+    face_off[axis] = 1;
+    for(Uns j = 0; j < 4; ++j) {
+        //@NOTE swapping the two corners off the 0-3 diagonal mirrors the quad
+        //onto itself, which flips the winding of both its triangles
+        Uns corner = sign || j == 0 || j == 3 ? j : 3 - j;
+        auto& vert = verts[corner];
+        vert.pos  = (Vec3<U8>)to_idx_pos(face.idx) + face_off +
+            vert_offs[axis * 4 + j] * scale;
+        vert.norm = face.orientation;
+        vert.tex  = face.id;
+    }
+}
+
+static void build_face(Mesh::Vert* verts, MeshFace const& face) {
+    build_quad(verts, face, Vec3<U8>(1));
+}
+
+static void build_mesh(DynArr<Mesh::Vert>& verts,
+                       DynArr<MeshFace> const& faces) {
+    verts.resize(faces.len * 4);
+    for(Uns i = 0; i < faces.len; ++i) {
+        build_face(verts.beg + i * 4, faces[i]);
+    }
+}
+
+static void mesh_update_box(Mesh& mesh) {
+    Vec3<U8> box_min(CHK_SIZE);
+    Vec3<U8> box_max(0);
+    for(auto const& face : mesh.faces) {
+        U8 axis = (face.orientation & 0b110) >> 1;
+        Vec3<U8> face_off(0);
+        face_off[axis] = 1;
+        Vec3<U8> face_min = (Vec3<U8>)to_idx_pos(face.idx) + face_off;
+        box_min = glm::min(box_min, face_min);
+        box_max = glm::max(box_max, face_min + Vec3<U8>(1) - face_off);
+    }
+    mesh.box_min = box_min;
+    mesh.box_max = box_max;
+}
+
+///downsampled meshes are rounded outwards to their grid
+static void mesh_get_box(Mesh const& mesh,
+                         Vec3<U8>& box_min, Vec3<U8>& box_max) {
+    U8 scale = 1 << mesh.lod;
+    box_min = (mesh.box_min / scale) * scale;
+    box_max = glm::min(((mesh.box_max + (U8)(scale - 1)) / scale) * scale,
+                       Vec3<U8>(CHK_SIZE));
+}
+
+static void build_lod_quad(Mesh::Vert* verts, U8 axis, U8 sign,
+                           Vec3<U8> const& origin, U8 size, BlockId id) {
+    for(Uns j = 0; j < 4; ++j) {
+        //@NOTE same winding as in build_quad
+        Uns corner = sign || j == 0 || j == 3 ? j : 3 - j;
+        auto& vert = verts[corner];
+        vert.pos  = origin + vert_offs[axis * 4 + j] * size;
+        vert.norm = (axis << 1) | sign;
+        vert.tex  = id;
+    }
+}
+
+///downsamples the faces 2^lod times, every face is moved outwards of its
+///block to the border of its coarse cell, so that the coarse surface covers
+///the fine one, coarse faces on the chunk border get skirts going into the
+///solid side, which hide the cracks towards chunks with a different lod
+static void build_lod_mesh(DynArr<Mesh::Vert>& verts,
+                           DynArr<MeshFace> const& faces, U8 lod) {
+    U8  const scale = 1 << lod;
+    Uns const cells = CHK_SIZE / scale;
+    Uns const planes = cells + 1;
+    ///coarse faces by axis, sign, plane and the coarse cell in the plane,
+    ///0 is empty, otherwise the block id + 1
+    static thread_local DynArr<U16> coarse;
+    coarse.resize(3 * 2 * planes * cells * cells);
+    std::memset(coarse.beg, 0, coarse.len * sizeof(U16));
+    auto get_coarse_idx = [&](Uns axis, Uns sign, Uns plane, Uns u, Uns v) {
+        return (((axis * 2 + sign) * planes + plane) * cells + u) * cells + v;
+    };
+    for(auto const& face : faces) {
+        U8 axis = (face.orientation & 0b110) >> 1;
+        U8 sign = (face.orientation & 1);
+        auto idx_pos = to_idx_pos(face.idx);
+        Uns fine_plane = idx_pos[axis] + 1;
+        //@NOTE the solid is below positive faces and above negative ones
+        Uns plane = sign ? (fine_plane + scale - 1) / scale :
+                           fine_plane / scale;
+        Uns u = idx_pos[(axis + 1) % 3] / scale;
+        Uns v = idx_pos[(axis + 2) % 3] / scale;
+        auto& id = coarse[get_coarse_idx(axis, sign, plane, u, v)];
+        if(id == 0) id = face.id + 1;
+    }
+    verts.clear();
+    for(Uns axis = 0; axis < 3; ++axis) {
+        Uns u_axis = (axis + 1) % 3;
+        Uns v_axis = (axis + 2) % 3;
+        for(Uns sign = 0; sign < 2; ++sign) {
+            for(Uns plane = 0; plane < planes; ++plane) {
+                for(Uns u = 0; u < cells; ++u) {
+                    for(Uns v = 0; v < cells; ++v) {
+                        U16 id =
+                            coarse[get_coarse_idx(axis, sign, plane, u, v)];
+                        if(id == 0) continue;
+                        //@NOTE solid on both sides, so it can't be seen
+                        if(coarse[get_coarse_idx(axis, !sign, plane, u, v)]) {
+                            continue;
+                        }
+                        Vec3<U8> origin;
+                        origin[axis]   = plane * scale;
+                        origin[u_axis] = u * scale;
+                        origin[v_axis] = v * scale;
+                        Uns off = verts.len;
+                        verts.resize(off + 4);
+                        build_lod_quad(verts.beg + off, axis, sign, origin,
+                                       scale, id - 1);
+                        //@NOTE the skirt spans the coarse cell behind the face
+                        I32 skirt_beg = sign ? (I32)origin[axis] - scale :
+                                               (I32)origin[axis];
+                        if(skirt_beg < 0 || skirt_beg + scale > CHK_SIZE) {
+                            continue;
+                        }
+                        Uns const in_plane[2] = {u_axis, v_axis};
+                        Uns const coords[2]   = {u, v};
+                        for(Uns i = 0; i < 2; ++i) {
+                            Uns skirt_axis = in_plane[i];
+                            for(Uns skirt_sign = 0; skirt_sign < 2;
+                                ++skirt_sign) {
+                                if(coords[i] != (skirt_sign ? cells - 1 : 0)) {
+                                    continue;
+                                }
+                                Vec3<U8> skirt_origin = origin;
+                                skirt_origin[axis] = skirt_beg;
+                                skirt_origin[skirt_axis] =
+                                    skirt_sign ? CHK_SIZE : 0;
+                                off = verts.len;
+                                verts.resize(off + 4);
+                                build_lod_quad(verts.beg + off, skirt_axis,
+                                               skirt_sign, skirt_origin,
+                                               scale, id - 1);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+///flood fills the chunk through the cells not separated by faces and links
+///the sides touched by every air component, a face has air on the side its
+///normal points to, components without any faces are assumed to be air
+static void build_side_links(Arr<U8, 6>& side_links,
+                             DynArr<MeshFace> const& faces) {
+    Uns constexpr CHK_VOL = CHK_SIZE * CHK_SIZE * CHK_SIZE;
+    ///the lower three bits mark a face on the positive side of the cell
+    U8 constexpr IS_AIR     = 1 << 3;
+    U8 constexpr IS_SOLID   = 1 << 4;
+    U8 constexpr IS_VISITED = 1 << 5;
+    Uns const strides[3] = {1, CHK_SIZE, CHK_SIZE * CHK_SIZE};
+    //@NOTE the mesher threads call this concurrently
+    static thread_local DynArr<U8>  cells;
+    static thread_local DynArr<U16> stack;
+    cells.resize(CHK_VOL);
+    std::memset(cells.beg, 0, cells.len);
+    for(auto const& face : faces) {
+        U8 axis = (face.orientation & 0b110) >> 1;
+        U8 sign = (face.orientation & 1);
+        auto idx_pos = to_idx_pos(face.idx);
+        Uns cell = idx_pos.x * strides[0] +
+                   idx_pos.y * strides[1] +
+                   idx_pos.z * strides[2];
+        cells[cell] |= 1 << axis;
+        cells[cell] |= sign ? IS_SOLID : IS_AIR;
+        if(idx_pos[axis] + 1 < CHK_SIZE) {
+            cells[cell + strides[axis]] |= sign ? IS_AIR : IS_SOLID;
+        }
+    }
+    for(auto& links : side_links) links = 0;
+    for(Uns start = 0; start < CHK_VOL; ++start) {
+        if(cells[start] & IS_VISITED) continue;
+        U8 sides = 0;
+        U8 kind  = 0;
+        cells[start] |= IS_VISITED;
+        stack.clear();
+        stack.push(start);
+        while(stack.len > 0) {
+            Uns cell = stack[stack.len - 1];
+            stack.erase(stack.len - 1, 1);
+            kind |= cells[cell] & (IS_AIR | IS_SOLID);
+            for(Uns axis = 0; axis < 3; ++axis) {
+                Uns coord = (cell / strides[axis]) % CHK_SIZE;
+                //@NOTE faces on the negative sides belong to the neighboring
+                //chunks, so these sides are never closed
+                if(coord == 0) {
+                    sides |= 1 << (axis * 2);
+                } else if(not (cells[cell - strides[axis]] & (1 << axis))) {
+                    Uns next = cell - strides[axis];
+                    if(not (cells[next] & IS_VISITED)) {
+                        cells[next] |= IS_VISITED;
+                        stack.push(next);
+                    }
+                }
+                if(cells[cell] & (1 << axis)) continue;
+                if(coord == CHK_SIZE - 1) {
+                    sides |= 1 << (axis * 2 + 1);
+                } else {
+                    Uns next = cell + strides[axis];
+                    if(not (cells[next] & IS_VISITED)) {
+                        cells[next] |= IS_VISITED;
+                        stack.push(next);
+                    }
+                }
+            }
+        }
+        if((kind & IS_AIR) || not (kind & IS_SOLID)) {
+            for(Uns side = 0; side < 6; ++side) {
+                if(sides & (1 << side)) side_links[side] |= sides;
+            }
+        }
+    }
+}
+
+///faces built by build_mesh occupy the quad slots in order
+static void reset_quad_slots(Mesh& mesh) {
+    mesh.free_quads.clear();
+    mesh.dirty_quads.clear();
+    mesh.quad_slots.resize(mesh.is_greedy || mesh.lod > 0 ?
+                           0 : mesh.verts.len / 4);
+    for(Uns i = 0; i < mesh.quad_slots.len; ++i) {
+        mesh.quad_slots[i] = i;
+    }
+}
+
+///merges adjacent coplanar faces with the same orientation and texture into
+///larger quads, faces are bucketed by orientation and plane and every plane
+///is swept for the largest rectangles
+static void build_greedy_mesh(DynArr<Mesh::Vert>& verts,
+                              DynArr<MeshFace> const& faces) {
+    SizeT constexpr planes_num = 6 * CHK_SIZE;
+    //@NOTE the axes along which the quad corners of vert_offs are spread
+    U8 constexpr u_axes[3] = {1, 2, 0};
+    U8 constexpr v_axes[3] = {2, 0, 1};
+    auto get_plane = [&](MeshFace const& face) -> Uns {
+        U8 axis = (face.orientation & 0b110) >> 1;
+        LUX_ASSERT(axis != 0b11);
+        return (face.orientation & 0b111) * CHK_SIZE + to_idx_pos(face.idx)[axis];
+    };
+
+    Arr<U32, planes_num + 1> plane_offs;
+    for(auto& off : plane_offs) off = 0;
+    for(auto const& face : faces) {
+        plane_offs[get_plane(face) + 1]++;
+    }
+    for(Uns i = 0; i < planes_num; ++i) {
+        plane_offs[i + 1] += plane_offs[i];
+    }
+    thread_local DynArr<U32> sorted;
+    sorted.resize(faces.len);
+    {   Arr<U32, planes_num> it;
+        for(Uns i = 0; i < planes_num; ++i) it[i] = plane_offs[i];
+        for(Uns i = 0; i < faces.len; ++i) {
+            sorted[it[get_plane(faces[i])]++] = i;
+        }
+    }
+
+    verts.resize(faces.len * 4);
+    Uns quads_num = 0;
+    Arr<I32, CHK_SIZE * CHK_SIZE> mask;
+    for(auto& cell : mask) cell = -1;
+    for(Uns plane = 0; plane < planes_num; ++plane) {
+        if(plane_offs[plane] == plane_offs[plane + 1]) continue;
+        U8 orientation = plane / CHK_SIZE;
+        U8 axis   = orientation >> 1;
+        U8 u_axis = u_axes[axis];
+        U8 v_axis = v_axes[axis];
+        for(Uns i = plane_offs[plane]; i < plane_offs[plane + 1]; ++i) {
+            MeshFace const& face = faces[sorted[i]];
+            IdxPos idx_pos = to_idx_pos(face.idx);
+            mask[idx_pos[u_axis] + idx_pos[v_axis] * CHK_SIZE] = face.id;
+        }
+        for(Uns v = 0; v < CHK_SIZE; ++v) {
+            for(Uns u = 0; u < CHK_SIZE;) {
+                I32 tex = mask[u + v * CHK_SIZE];
+                if(tex < 0) {
+                    ++u;
+                    continue;
+                }
+                Uns w = 1;
+                while(u + w < CHK_SIZE && mask[u + w + v * CHK_SIZE] == tex) {
+                    ++w;
+                }
+                Uns h = 1;
+                while(v + h < CHK_SIZE) {
+                    bool is_row_same = true;
+                    for(Uns k = 0; k < w; ++k) {
+                        if(mask[u + k + (v + h) * CHK_SIZE] != tex) {
+                            is_row_same = false;
+                            break;
+                        }
+                    }
+                    if(not is_row_same) break;
+                    ++h;
+                }
+                for(Uns y = 0; y < h; ++y) {
+                    for(Uns x = 0; x < w; ++x) {
+                        mask[u + x + (v + y) * CHK_SIZE] = -1;
+                    }
+                }
+                IdxPos idx_pos;
+                idx_pos[axis]   = plane % CHK_SIZE;
+                idx_pos[u_axis] = u;
+                idx_pos[v_axis] = v;
+                Vec3<U8> scale(1);
+                scale[u_axis] = w;
+                scale[v_axis] = h;
+                build_quad(verts.beg + quads_num * 4,
+                           {to_chk_idx(idx_pos), orientation, (BlockId)tex},
+                           scale);
+                ++quads_num;
+                u += w;
+            }
+        }
+    }
+    verts.resize(quads_num * 4);
+}
+
+///grows the shared quad index buffer to fit at least quads_num quads
+static void reserve_quad_idxs(SizeT quads_num) {
+    if(quads_num <= quad_i_buff_len) return;
+    quad_i_buff_len = max(quads_num, quad_i_buff_len * 2);
+    static DynArr<U32> idxs;
+    idxs.resize(quad_i_buff_len * 6);
+    for(Uns i = 0; i < quad_i_buff_len; ++i) {
+        for(Uns j = 0; j < 6; ++j) {
+            idxs[i * 6 + j] = quad_idxs<U32>[j] + i * 4;
+        }
+    }
+    //@NOTE we don't use the element array target, as that would change the
+    //currently bound vertex array
+    quad_i_buff.bind(GL_COPY_WRITE_BUFFER);
+    quad_i_buff.Buff::write(GL_COPY_WRITE_BUFFER, idxs.len, idxs.beg,
+                            GL_STATIC_DRAW);
+}
+
+static void arena_create() {
+    arenas.resize(arenas.len + 1);
+    GeomArena& arena = arenas[arenas.len - 1];
+    LUX_LOG("creating geometry arena #%zu", arenas.len - 1);
+    gl::VertContext::unbind_all();
+    arena.v_buff.init();
+    arena.v_buff.bind();
+    glBufferData(GL_ARRAY_BUFFER,
+        ARENA_PAGES_NUM * ARENA_PAGE_VERTS * sizeof(Mesh::Vert),
+        nullptr, GL_DYNAMIC_DRAW);
+    arena.context.init({arena.v_buff}, vert_fmt);
+    quad_i_buff.bind();
+    gl::VertContext::unbind_all();
+
+    arena.pages_buff.init();
+    arena.pages_buff.bind(GL_TEXTURE_BUFFER);
+    glBufferData(GL_TEXTURE_BUFFER, ARENA_PAGES_NUM * sizeof(Vec4F),
+                 nullptr, GL_DYNAMIC_DRAW);
+    glGenTextures(1, &arena.pages_tex);
+    glBindTexture(GL_TEXTURE_BUFFER, arena.pages_tex);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, arena.pages_buff.id);
+    arena.free_spans.clear();
+    arena.free_spans.push({0, ARENA_PAGES_NUM});
+
+    if(gl_ext.has_compute) {
+        static DynArr<CullChunk> empty_chunks;
+        empty_chunks.resize(ARENA_PAGES_NUM);
+        std::memset(empty_chunks.beg, 0, sizeof(CullChunk) * empty_chunks.len);
+        arena.chunks_buff.init();
+        arena.chunks_buff.bind(GL_COPY_WRITE_BUFFER);
+        arena.chunks_buff.write(GL_COPY_WRITE_BUFFER, empty_chunks.len,
+                                empty_chunks.beg, GL_DYNAMIC_DRAW);
+        arena.cmds_buff.init();
+        arena.cmds_buff.bind(GL_COPY_WRITE_BUFFER);
+        glBufferData(GL_COPY_WRITE_BUFFER, ARENA_PAGES_NUM * 5 * sizeof(U32),
+                     nullptr, GL_DYNAMIC_COPY);
+    }
+}
+
+static void arena_write_cull_chunk(ArenaAlloc const& alloc,
+                                   CullChunk const& chunk) {
+    if(not gl_ext.has_compute) return;
+    auto& arena = arenas[alloc.arena];
+    arena.chunks_buff.bind(GL_COPY_WRITE_BUFFER);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, alloc.page * sizeof(CullChunk),
+                    sizeof(CullChunk), &chunk);
+}
+
+///the number of leading slots that may hold chunks
+static U32 arena_get_slots_num(GeomArena const& arena) {
+    if(arena.free_spans.len > 0) {
+        auto const& last = arena.free_spans[arena.free_spans.len - 1];
+        if(last.page + last.pages_num == ARENA_PAGES_NUM) return last.page;
+    }
+    return ARENA_PAGES_NUM;
+}
+
+///first-fit, a new arena is created if none of them has enough space
+static void arena_alloc(ArenaAlloc& alloc, SizeT verts_num) {
+    U32 pages_num = (verts_num + ARENA_PAGE_VERTS - 1) / ARENA_PAGE_VERTS;
+    LUX_ASSERT(pages_num > 0 && pages_num <= ARENA_PAGES_NUM);
+    for(U32 i = 0; i <= arenas.len; ++i) {
+        if(i == arenas.len) arena_create();
+        auto& spans = arenas[i].free_spans;
+        for(Uns j = 0; j < spans.len; ++j) {
+            auto& span = spans[j];
+            if(span.pages_num < pages_num) continue;
+            alloc = {i, span.page, pages_num};
+            span.page      += pages_num;
+            span.pages_num -= pages_num;
+            if(span.pages_num == 0) {
+                spans.erase(j, 1);
+            }
+            return;
+        }
+    }
+    LUX_UNREACHABLE();
+}
+
+static void arena_free(ArenaAlloc& alloc) {
+    if(alloc.pages_num == 0) return;
+    arena_write_cull_chunk(alloc, {});
+    auto& spans = arenas[alloc.arena].free_spans;
+    Uns j = 0;
+    while(j < spans.len && spans[j].page < alloc.page) ++j;
+    bool merge_prev = j > 0 &&
+        spans[j - 1].page + spans[j - 1].pages_num == alloc.page;
+    bool merge_next = j < spans.len &&
+        alloc.page + alloc.pages_num == spans[j].page;
+    if(merge_prev && merge_next) {
+        spans[j - 1].pages_num += alloc.pages_num + spans[j].pages_num;
+        spans.erase(j, 1);
+    } else if(merge_prev) {
+        spans[j - 1].pages_num += alloc.pages_num;
+    } else if(merge_next) {
+        spans[j].page       = alloc.page;
+        spans[j].pages_num += alloc.pages_num;
+    } else {
+        spans.resize(spans.len + 1);
+        for(Uns k = spans.len - 1; k > j; --k) {
+            spans[k] = spans[k - 1];
+        }
+        spans[j] = {alloc.page, alloc.pages_num};
+    }
+    alloc.pages_num = 0;
+}
+
+static void arena_deinit() {
+    for(auto& arena : arenas) {
+        if(gl_ext.has_compute) {
+            arena.cmds_buff.deinit();
+            arena.chunks_buff.deinit();
+        }
+        glDeleteTextures(1, &arena.pages_tex);
+        arena.pages_buff.deinit();
+        arena.context.deinit();
+        arena.v_buff.deinit();
+    }
+    arenas.clear();
+}
+
+///writes the verts of a mesh to its arena pages, reallocating them if the
+///page count changed
+static void mesh_write_cull_chunk(Mesh const& mesh, ChkPos const& pos);
+
+static void mesh_upload_verts(Mesh& mesh, ChkPos const& pos) {
+    if(mesh.verts.len == 0) {
+        arena_free(mesh.geom);
+        return;
+    }
+    U32 pages_num =
+        (mesh.verts.len + ARENA_PAGE_VERTS - 1) / ARENA_PAGE_VERTS;
+    if(pages_num != mesh.geom.pages_num) {
+        arena_free(mesh.geom);
+        arena_alloc(mesh.geom, mesh.verts.len);
+        static DynArr<Vec4F> pages;
+        pages.resize(pages_num);
+        for(auto& page : pages) {
+            page = Vec4F((Vec3F)pos * (F32)CHK_SIZE, 0.f);
+        }
+        auto& arena = arenas[mesh.geom.arena];
+        arena.pages_buff.bind(GL_TEXTURE_BUFFER);
+        glBufferSubData(GL_TEXTURE_BUFFER, mesh.geom.page * sizeof(Vec4F),
+                        pages.len * sizeof(Vec4F), pages.beg);
+    }
+    auto& arena = arenas[mesh.geom.arena];
+    arena.v_buff.bind();
+    glBufferSubData(GL_ARRAY_BUFFER,
+        mesh.geom.page * ARENA_PAGE_VERTS * sizeof(Mesh::Vert),
+        mesh.verts.len * sizeof(Mesh::Vert), mesh.verts.beg);
+    reserve_quad_idxs(mesh.verts.len / 4);
+    mesh_write_cull_chunk(mesh, pos);
+}
+
+///uploads only the given quads, the mesh must already have its pages
+static void mesh_upload_quads(Mesh& mesh, ChkPos const& pos,
+                              DynArr<U32> const& quads) {
+    U32 pages_num =
+        (mesh.verts.len + ARENA_PAGE_VERTS - 1) / ARENA_PAGE_VERTS;
+    if(mesh.verts.len == 0 || pages_num != mesh.geom.pages_num) {
+        mesh_upload_verts(mesh, pos);
+        return;
+    }
+    auto& arena = arenas[mesh.geom.arena];
+    arena.v_buff.bind();
+    for(auto quad : quads) {
+        glBufferSubData(GL_ARRAY_BUFFER,
+            (mesh.geom.page * ARENA_PAGE_VERTS + quad * 4) * sizeof(Mesh::Vert),
+            4 * sizeof(Mesh::Vert), mesh.verts.beg + quad * 4);
+    }
+    reserve_quad_idxs(mesh.verts.len / 4);
+    mesh_write_cull_chunk(mesh, pos);
+}
+
+static void mesh_write_cull_chunk(Mesh const& mesh, ChkPos const& pos) {
+    CullChunk cull_chunk = {};
+    Vec3F chk_translation = (Vec3F)pos * (F32)CHK_SIZE;
+    Vec3<U8> box_min, box_max;
+    mesh_get_box(mesh, box_min, box_max);
+    cull_chunk.box_min   = Vec4F(chk_translation + (Vec3F)box_min, 1.f);
+    cull_chunk.box_max   = Vec4F(chk_translation + (Vec3F)box_max, 1.f);
+    cull_chunk.pos       = Vec4F((Vec3F)pos, 1.f);
+    cull_chunk.idxs_num  = (mesh.verts.len / 4) * 6;
+    cull_chunk.base_vert = mesh.geom.page * ARENA_PAGE_VERTS;
+    arena_write_cull_chunk(mesh.geom, cull_chunk);
+}
+
+static void mesher_worker() {
+    while(true) {
+        MeshJob job;
+        {   std::unique_lock<std::mutex> lock(mesher.jobs_mutex);
+            mesher.jobs_cond.wait(lock, [] {
+                return mesher.should_stop || not mesher.jobs.empty();
+            });
+            if(mesher.should_stop) return;
+            job = move(mesher.jobs.front());
+            mesher.jobs.pop_front();
+        }
+        MeshResult result;
+        result.pos = job.pos;
+        result.id  = job.id;
+        result.greedy = job.greedy;
+        result.lod    = job.lod;
+        if(job.lod > 0) {
+            build_lod_mesh(result.verts, job.faces, job.lod);
+        } else if(job.greedy) {
+            build_greedy_mesh(result.verts, job.faces);
+        } else {
+            build_mesh(result.verts, job.faces);
+        }
+        build_side_links(result.side_links, job.faces);
+        {   std::lock_guard<std::mutex> lock(mesher.results_mutex);
+            mesher.results.emplace_back(move(result));
+        }
+    }
+}
+
+static void mesher_init() {
+    Uns threads_num = max(std::thread::hardware_concurrency(), 2u) - 1;
+    LUX_LOG("starting %zu mesher threads", threads_num);
+    for(Uns i = 0; i < threads_num; ++i) {
+        mesher.threads.emplace_back(&mesher_worker);
+    }
+}
+
+static void mesher_deinit() {
+    {   std::lock_guard<std::mutex> lock(mesher.jobs_mutex);
+        mesher.should_stop = true;
+    }
+    mesher.jobs_cond.notify_all();
+    for(auto& thread : mesher.threads) {
+        thread.join();
+    }
+    mesher.threads.clear();
+}
+
+///chunks further than lod_dist are downsampled 2x, then 4x past twice that
+///distance and 8x past four times that distance
+static U8 get_chunk_lod(ChkPos const& pos) {
+    if(not lod_enabled) return 0;
+    ChkPos diff = pos - last_player_chk_pos;
+    ChkCoord dist_sq = diff.x * diff.x + diff.y * diff.y + diff.z * diff.z;
+    U8 lod = 0;
+    ChkCoord ring_dist = lod_dist;
+    while(lod < LOD_MAX && dist_sq > ring_dist * ring_dist) {
+        ++lod;
+        ring_dist *= 2;
+    }
+    return lod;
+}
+
+///schedules a rebuild of the mesh from its faces, any pending build becomes
+///stale and its result will be dropped
+static void mesher_enqueue(Mesh& mesh, ChkPos const& pos) {
+    MeshJob job;
+    job.pos = pos;
+    job.id  = ++mesher.last_job_id;
+    job.greedy = greedy_meshing;
+    job.lod    = get_chunk_lod(pos);
+    job.faces.resize(mesh.faces.len);
+    std::memcpy(job.faces.beg, mesh.faces.beg,
+                sizeof(MeshFace) * mesh.faces.len);
+    mesh.job_id = job.id;
+    {   std::lock_guard<std::mutex> lock(mesher.jobs_mutex);
+        mesher.jobs.emplace_back(move(job));
+    }
+    mesher.jobs_cond.notify_one();
+}
+
+///the mesh grid is toroidal, a chunk lives in the slot given by its position
+///modulo the grid size, so moving the load volume doesn't move the meshes
+static ChkPos wrap_chk_pos(ChkPos pos, ChkCoord size) {
+    pos %= size;
+    for(Uns i = 0; i < 3; ++i) {
+        if(pos[i] < 0) pos[i] += size;
+    }
+    return pos;
+}
+
+static Uns get_grid_idx(ChkPos pos, ChkCoord size) {
+    pos = wrap_chk_pos(pos, size);
+    return pos.x + pos.y * size + pos.z * size * size;
+}
+
+static ChkPos get_grid_pos(Uns idx, ChkCoord size) {
+    ChkCoord i = idx;
+    return {i % size, (i / size) % size, i / (size * size)};
+}
+
+static Int get_fov_idx(ChkPos const& pos);
+static ChkPos get_fov_pos(Uns idx);
+static void chunk_cache_erase(ChkPos const& pos);
+static void map_flush_updates();
+
+///uploads the meshes finished by the workers, must be called on the GL thread
+static void mesher_integrate() {
+    static std::deque<MeshResult> results;
+    {   std::lock_guard<std::mutex> lock(mesher.results_mutex);
+        swap(results, mesher.results);
+    }
+    gl::VertContext::unbind_all();
+    for(auto& result : results) {
+        Int idx = get_fov_idx(result.pos);
+        //@NOTE the chunk might have been unloaded or updated in the meantime
+        if(idx < 0 || not meshes[idx].is_allocated ||
+           meshes[idx].job_id != result.id) {
+            continue;
+        }
+        Mesh& mesh = meshes[idx];
+        mesh.verts  = move(result.verts);
+        mesh.job_id = 0;
+        mesh.is_greedy = result.greedy;
+        mesh.lod       = result.lod;
+        mesh.is_pulled = false;
+        mesh.side_links = result.side_links;
+        reset_quad_slots(mesh);
+        mesh_upload_verts(mesh, result.pos);
+    }
+    results.clear();
+}
+
+///planes of the clip space frustum as ax + by + cz + d >= 0 for points
+///inside of it, not normalized
+static void get_frustum_planes(glm::mat4 const& mvp, Arr<Vec4F, 6>& planes) {
+    Vec4F row_x = glm::row(mvp, 0);
+    Vec4F row_y = glm::row(mvp, 1);
+    Vec4F row_z = glm::row(mvp, 2);
+    Vec4F row_w = glm::row(mvp, 3);
+    planes[0] = row_w + row_x;
+    planes[1] = row_w - row_x;
+    planes[2] = row_w + row_y;
+    planes[3] = row_w - row_y;
+    planes[4] = row_w + row_z;
+    planes[5] = row_w - row_z;
+}
+
+///offsets of the chunks in render distance, nearest first, so that the culled
+///chunks come out sorted by distance without sorting them every frame
+static DynArr<ChkPos> dist_offs;
+static ChkCoord       dist_offs_render_dist = -1;
+
+static void build_dist_offs() {
+    auto get_len_sq = [](ChkPos const& off) {
+        return off.x * off.x + off.y * off.y + off.z * off.z;
+    };
+    dist_offs.clear();
+    ChkPos off;
+    for(off.z = -render_dist; off.z <= render_dist; ++off.z) {
+        for(off.y = -render_dist; off.y <= render_dist; ++off.y) {
+            for(off.x = -render_dist; off.x <= render_dist; ++off.x) {
+                if(get_len_sq(off) <= render_dist * render_dist) {
+                    dist_offs.push(off);
+                }
+            }
+        }
+    }
+    std::stable_sort(dist_offs.begin(), dist_offs.end(),
+        [&](ChkPos const& a, ChkPos const& b) {
+            return get_len_sq(a) < get_len_sq(b);
+        });
+    dist_offs_render_dist = render_dist;
+}
+
+///chunk bounds in SoA layout, so that they can be tested against the frustum
+///several at a time
+static struct {
+    DynArr<F32>   min_x, min_y, min_z;
+    DynArr<F32>   max_x, max_y, max_z;
+    DynArr<U8>    is_visible;
+    DynArr<U32>   mesh_idxs;
+    DynArr<Vec3F> poses;
+    SizeT len = 0;
+
+    void clear() {
+        len = 0;
+        min_x.clear(); min_y.clear(); min_z.clear();
+        max_x.clear(); max_y.clear(); max_z.clear();
+        mesh_idxs.clear();
+        poses.clear();
+    }
+
+    void push(U32 mesh_idx, ChkPos const& pos,
+              Vec3<U8> const& box_min, Vec3<U8> const& box_max) {
+        Vec3F chk_translation = (Vec3F)pos * (F32)CHK_SIZE;
+        Vec3F f_min = chk_translation + (Vec3F)box_min;
+        Vec3F f_max = chk_translation + (Vec3F)box_max;
+        min_x.push(f_min.x); min_y.push(f_min.y); min_z.push(f_min.z);
+        max_x.push(f_max.x); max_y.push(f_max.y); max_z.push(f_max.z);
+        mesh_idxs.push(mesh_idx);
+        poses.push((Vec3F)pos);
+        ++len;
+    }
+
+    ///a box is visible unless it lies fully behind one of the planes, the
+    ///corner furthest along the plane normal is the one that gets tested
+    void cull(Arr<Vec4F, 6> const& planes) {
+        //@NOTE the padding lets us process whole batches
+        SizeT padded_len = (len + 3) & ~(SizeT)3;
+        for(auto* arr : {&min_x, &min_y, &min_z, &max_x, &max_y, &max_z}) {
+            arr->resize(padded_len);
+        }
+        is_visible.resize(padded_len);
+        for(SizeT i = 0; i < padded_len; i += 4) {
+#ifdef __SSE2__
+            __m128 visible = _mm_castsi128_ps(_mm_set1_epi32(-1));
+            for(auto const& plane : planes) {
+                F32 const* px_arr = (plane.x > 0.f ? max_x : min_x).beg;
+                F32 const* py_arr = (plane.y > 0.f ? max_y : min_y).beg;
+                F32 const* pz_arr = (plane.z > 0.f ? max_z : min_z).beg;
+                __m128 px = _mm_loadu_ps(px_arr + i);
+                __m128 py = _mm_loadu_ps(py_arr + i);
+                __m128 pz = _mm_loadu_ps(pz_arr + i);
+                __m128 dist = _mm_add_ps(
+                    _mm_add_ps(_mm_mul_ps(px, _mm_set1_ps(plane.x)),
+                               _mm_mul_ps(py, _mm_set1_ps(plane.y))),
+                    _mm_add_ps(_mm_mul_ps(pz, _mm_set1_ps(plane.z)),
+                               _mm_set1_ps(plane.w)));
+                visible = _mm_and_ps(visible,
+                    _mm_cmpge_ps(dist, _mm_setzero_ps()));
+            }
+            int mask = _mm_movemask_ps(visible);
+            for(Uns j = 0; j < 4; ++j) {
+                is_visible[i + j] = (mask >> j) & 1;
+            }
+#else
+            for(Uns j = i; j < i + 4; ++j) {
+                is_visible[j] = true;
+                for(auto const& plane : planes) {
+                    F32 px = plane.x > 0.f ? max_x[j] : min_x[j];
+                    F32 py = plane.y > 0.f ? max_y[j] : min_y[j];
+                    F32 pz = plane.z > 0.f ? max_z[j] : min_z[j];
+                    if(plane.x * px + plane.y * py + plane.z * pz +
+                       plane.w < 0.f) {
+                        is_visible[j] = false;
+                        break;
+                    }
+                }
+            }
+#endif
+        }
+    }
+} cull_boxes;
+
+///4-byte face record read by glsl/block_pull.vert: the in-chunk position in
+///5 bits per axis, the orientation and the block id in the remaining bits
+static U32 pack_face(MeshFace const& face) {
+    static_assert(CHK_SIZE <= 32, "face record position is 5 bits per axis");
+    IdxPos idx_pos = to_idx_pos(face.idx);
+    return  (U32)idx_pos.x               |
+            (U32)idx_pos.y         <<  5 |
+            (U32)idx_pos.z         << 10 |
+           ((U32)face.orientation & 0b111) << 15 |
+            (U32)face.id           << 18;
+}
+
+///uploads the face records of a mesh for vertex pulling, the quads are
+///expanded on the GPU, so no verts are built at all
+static void mesh_upload_faces(Mesh& mesh) {
+    static DynArr<U32> records;
+    records.resize(mesh.faces.len);
+    for(Uns i = 0; i < mesh.faces.len; ++i) {
+        records[i] = pack_face(mesh.faces[i]);
+    }
+    gl::VertContext::unbind_all();
+    mesh.v_buff.bind();
+    mesh.v_buff.write(records.len, records.beg, GL_DYNAMIC_DRAW);
+    glBindTexture(GL_TEXTURE_BUFFER, mesh.faces_tex);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_R32UI, mesh.v_buff.id);
+    mesh.verts.clear();
+    arena_free(mesh.geom);
+    //@NOTE pulled meshes don't go through the mesher
+    build_side_links(mesh.side_links, mesh.faces);
+    mesh.job_id    = 0;
+    mesh.is_greedy = false;
+    mesh.lod       = 0;
+    mesh.is_pulled = true;
+}
+
+static MeshFace unpack_face(U32 record) {
+    IdxPos idx_pos = { record        & 0b11111,
+                      (record >>  5) & 0b11111,
+                      (record >> 10) & 0b11111};
+    return {to_chk_idx(idx_pos), (U8)((record >> 15) & 0b111),
+            (BlockId)(record >> 18)};
+}
+
+///builds the mesh of an allocated mesh whose faces were just filled in
+static void mesh_load(Mesh& mesh, ChkPos const& pos) {
+    mesh.verts.clear();
+    mesh_update_box(mesh);
+    //@NOTE until the mesher is done, we assume the chunk to be see-through
+    for(auto& links : mesh.side_links) links = 0b111111;
+    if(vertex_pulling) {
+        mesh_upload_faces(mesh);
+    } else {
+        mesh.is_pulled = false;
+        mesher_enqueue(mesh, pos);
+    }
+}
+
+///faces of the chunks that left the load range, least recently evicted are
+///dropped first once the cache goes over its budget, this saves a request
+///and the network round-trip when the player comes back
+static struct {
+    struct Entry {
+        DynArr<U32> records;
+        U64         hash;
+        bool        is_stale;
+        std::list<ChkPos>::iterator lru_it;
+    };
+    std::unordered_map<ChkPos, Entry, ChkPosHash> entries;
+    ///the front is the most recently evicted
+    std::list<ChkPos> lru;
+    SizeT size = 0;
+    int   budget_mb = 32;
+    U64   hits_num = 0;
+} chunk_cache;
+static U64 disk_cache_hits_num = 0;
+
+static void chunk_cache_erase(ChkPos const& pos) {
+    auto it = chunk_cache.entries.find(pos);
+    if(it == chunk_cache.entries.end()) return;
+    chunk_cache.size -= it->second.records.len * sizeof(U32);
+    chunk_cache.lru.erase(it->second.lru_it);
+    chunk_cache.entries.erase(it);
+}
+
+static void chunk_cache_shrink() {
+    SizeT budget = (SizeT)chunk_cache.budget_mb * 1024 * 1024;
+    while(chunk_cache.size > budget) {
+        chunk_cache_erase(chunk_cache.lru.back());
+    }
+}
+
+static void pack_faces(DynArr<U32>& records, DynArr<MeshFace> const& faces) {
+    records.resize(faces.len);
+    for(Uns i = 0; i < faces.len; ++i) {
+        records[i] = pack_face(faces[i]);
+    }
+}
+
+static void unpack_faces(DynArr<MeshFace>& faces, DynArr<U32> const& records) {
+    faces.resize(records.len);
+    for(Uns i = 0; i < records.len; ++i) {
+        faces[i] = unpack_face(records[i]);
+    }
+}
+
+static void chunk_cache_put(ChkPos const& pos, Mesh const& mesh) {
+    chunk_cache_erase(pos);
+    chunk_cache.lru.push_front(pos);
+    auto& entry  = chunk_cache.entries[pos];
+    entry.lru_it = chunk_cache.lru.begin();
+    entry.hash     = mesh.faces_hash;
+    entry.is_stale = mesh.is_stale;
+    pack_faces(entry.records, mesh.faces);
+    chunk_cache.size += entry.records.len * sizeof(U32);
+    chunk_cache_shrink();
+}
+
+///loads the chunk from the cache, returns false if it isn't cached
+static bool chunk_cache_restore(ChkPos const& pos, Mesh& mesh) {
+    auto it = chunk_cache.entries.find(pos);
+    if(it == chunk_cache.entries.end()) return false;
+    auto const& entry = it->second;
+    mesh.alloc();
+    unpack_faces(mesh.faces, entry.records);
+    mesh.faces_hash = entry.hash;
+    mesh.is_stale   = entry.is_stale;
+    mesh_load(mesh, pos);
+    chunk_cache_erase(pos);
+    chunk_cache.hits_num++;
+    return true;
+}
+
+static void mesh_write_disk_cache(Mesh& mesh, ChkPos const& pos) {
+    static DynArr<U32> records;
+    pack_faces(records, mesh.faces);
+    mesh.faces_hash = disk_cache_hash(records);
+    disk_cache_write(pos, records, mesh.faces_hash);
+    mesh.is_disk_dirty = false;
+}
+
+///loads the chunk from the memory or disk cache, returns false if it isn't
+///cached, chunks from the disk cache are stale until the server confirms them
+static bool mesh_restore(Mesh& mesh, ChkPos const& pos) {
+    if(chunk_cache_restore(pos, mesh)) return true;
+    static DynArr<U32> records;
+    U64 hash;
+    if(not disk_cache_read(pos, records, hash)) return false;
+    mesh.alloc();
+    unpack_faces(mesh.faces, records);
+    mesh.faces_hash = hash;
+    mesh.is_stale   = true;
+    mesh_load(mesh, pos);
+    disk_cache_hits_num++;
+    return true;
+}
+
+///keeps the faces of a chunk that leaves the load range before deallocating
+static void mesh_evict(Mesh& mesh, ChkPos const& pos) {
+    //@NOTE faces of a pending mesh can still be in flux, but they are the
+    //latest ones we got from the server
+    if(mesh.is_disk_dirty) {
+        mesh_write_disk_cache(mesh, pos);
+    }
+    chunk_cache_put(pos, mesh);
+    mesh.dealloc();
+}
+
+///marks the chunks that can be seen from the camera chunk through the side
+///links, the search never goes back towards the camera, unloaded and unbuilt
+///chunks are treated as see-through
+static void find_visible_chunks(ChkPos const& chk_pos,
+                                DynArr<U8>& is_visible) {
+    struct Node {
+        ChkPos pos;
+        U8     entry_side;
+        U8     dirs;
+    };
+    U8 constexpr NO_SIDE = 6;
+    static std::deque<Node> queue;
+    is_visible.resize(meshes.len);
+    std::memset(is_visible.beg, 0, is_visible.len);
+    queue.clear();
+    Int start = get_fov_idx(chk_pos);
+    if(start < 0) return;
+    is_visible[start] = true;
+    queue.push_back({chk_pos, NO_SIDE, 0});
+    while(not queue.empty()) {
+        Node node = queue.front();
+        queue.pop_front();
+        Mesh const& mesh = meshes[get_fov_idx(node.pos)];
+        for(U8 side = 0; side < 6; ++side) {
+            //@NOTE the opposite side has the sign bit flipped
+            if(node.dirs & (1 << (side ^ 1))) continue;
+            if(node.entry_side != NO_SIDE && mesh.is_allocated &&
+               not (mesh.side_links[node.entry_side] & (1 << side))) {
+                continue;
+            }
+            ChkPos next = node.pos;
+            next[side >> 1] += (side & 1) ? 1 : -1;
+            ChkPos diff = next - chk_pos;
+            if(diff.x * diff.x + diff.y * diff.y + diff.z * diff.z >
+               render_dist * render_dist) {
+                continue;
+            }
+            Int idx = get_fov_idx(next);
+            if(idx < 0 || is_visible[idx]) continue;
+            is_visible[idx] = true;
+            queue.push_back({next, (U8)(side ^ 1),
+                             (U8)(node.dirs | (1 << side))});
+        }
+    }
+}
+
+void map_preload() {
+    asset_preload("tileset.png"           , false);
+    asset_preload("glsl/block.vert"       , false);
+    asset_preload("glsl/block.frag"       , false);
+    asset_preload("glsl/block_pull.vert"  , false);
+    asset_preload("glsl/chunk_cull.comp"  , false);
+    asset_preload("glsl/occl_box.vert"    , false);
+    asset_preload("glsl/occl_box.frag"    , false);
+    asset_preload("glsl/map_deferred.vert", false);
+    asset_preload("glsl/map_deferred.frag", false);
+}
+
+void map_start_programs() {
+    program_ids.block = load_program("glsl/block.vert", "glsl/block.frag");
+    program_ids.pull  =
+        load_program("glsl/block_pull.vert", "glsl/block.frag");
+    if(gl_ext.has_compute) {
+        program_ids.cull = load_compute_program("glsl/chunk_cull.comp");
+    }
+    program_ids.occl =
+        load_program("glsl/occl_box.vert", "glsl/occl_box.frag");
+    program_ids.deferred =
+        load_program("glsl/map_deferred.vert", "glsl/map_deferred.frag");
+}
+
 void map_init() {
     char const* tileset_path = "tileset.png";
     Vec2U const block_size = {1, 1};
-    program  = load_program("glsl/block.vert" , "glsl/block.frag");
-    Vec2U tileset_size;
-    tileset = load_texture(tileset_path, tileset_size);
-    Vec2F tex_scale = (Vec2F)block_size / (Vec2F)tileset_size;
-
-    glUseProgram(program);
-    set_uniform("tex_scale", program, glUniform2fv,
-                1, glm::value_ptr(tex_scale));
+    program.init(program_ids.block);
+    U32 tileset_layers_num;
+    tileset = load_texture_array(tileset_path, block_size, tileset_layers_num);
+    LUX_LOG("loaded %u tiles from %s", tileset_layers_num, tileset_path);
+
+    ///the samplers and constants never change, so they are set only once
+    program.use();
+    program.get_uniform<I32>("tileset").set(0);
+    program.get_uniform<I32>("pages").set(1);
+    program.get_uniform<I32>("page_verts").set(ARENA_PAGE_VERTS);
+
+    pull_program.init(program_ids.pull);
+    pull_program.use();
+    pull_program.get_uniform<I32>("tileset").set(0);
+    pull_program.get_uniform<I32>("faces").set(1);
+    {   I32 pull_quad_idxs[6];
+        for(Uns i = 0; i < 6; ++i) {
+            pull_quad_idxs[i] = quad_idxs<U16>[i];
+        }
+        pull_program.get_uniform<I32>("quad_idxs").set(pull_quad_idxs, 6);
+    }
+    uniforms.pull_chk_pos = pull_program.get_uniform<Vec3F>("chk_pos");
+    ///core profile doesn't allow drawing without a vertex array
+    glGenVertexArrays(1, &pull_context);
+    glGenQueries(1, &dyn_res.query);
+    if(gl_ext.has_compute) {
+        cull_program.init(program_ids.cull);
+        uniforms.cull_planes = cull_program.get_uniform<Vec4F>("planes");
+        uniforms.cull_cam_chk_pos =
+            cull_program.get_uniform<Vec3F>("cam_chk_pos");
+        uniforms.cull_render_dist =
+            cull_program.get_uniform<F32>("render_dist");
+        uniforms.cull_slots_num = cull_program.get_uniform<U32>("slots_num");
+    }
+    occl_program.init(program_ids.occl);
+    uniforms.occl_box_min = occl_program.get_uniform<Vec3F>("box_min");
+    uniforms.occl_box_max = occl_program.get_uniform<Vec3F>("box_max");
     vert_fmt.init(
         {{3, GL_UNSIGNED_BYTE, false, false},
          {1, GL_UNSIGNED_BYTE, false, false},   //@TODO this should be unsigned
@@ -117,15 +1404,14 @@ void map_init() {
 
     ui_map = ui_create(ui_camera);
     ui_nodes[ui_map].io_tick = &map_io_tick;
+    mesher_init();
 
     gl::VertContext::unbind_all();
+    quad_i_buff.init();
+    reserve_quad_idxs(CHK_SIZE * CHK_SIZE);
     debug_mesh_0.alloc();
 
     debug_mesh_0.verts.resize(4);
-    debug_mesh_0.idxs.resize(6);
-    for(Uns i = 0; i < 6; ++i) {
-        debug_mesh_0.idxs[i] = quad_idxs<U16>[i];
-    }
     for(Uns i = 0; i < 4; ++i) {
         debug_mesh_0.verts[i].pos  = Vec3<U8>(u_quad<U32>[i] * (U32)CHK_SIZE, 0);
         debug_mesh_0.verts[i].norm = 0b101;
@@ -133,51 +1419,35 @@ void map_init() {
     }
 
     gl::VertContext::unbind_all();
-    debug_mesh_0.i_buff.bind();
-    debug_mesh_0.i_buff.write(6, debug_mesh_0.idxs.beg, GL_STATIC_DRAW);
     debug_mesh_0.v_buff.bind();
     debug_mesh_0.v_buff.write(4, debug_mesh_0.verts.beg, GL_STATIC_DRAW);
 
     glGenFramebuffers(1, &renderer.g_buff);
     glBindFramebuffer(GL_FRAMEBUFFER, renderer.g_buff);
 
-    glGenTextures(1, &renderer.g_pos);
-    glBindTexture(GL_TEXTURE_2D, renderer.g_pos);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, 1600, 900, //@TODO screen sz
-                 0, GL_RGB, GL_FLOAT, nullptr);
+    glGenTextures(1, &renderer.g_col);
+    glBindTexture(GL_TEXTURE_2D, renderer.g_col);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
-                           renderer.g_pos, 0);
 
-    glGenTextures(1, &renderer.g_norm);
-    glBindTexture(GL_TEXTURE_2D, renderer.g_norm);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, 1600, 900, //@TODO screen sz
-                 0, GL_RGB, GL_FLOAT, nullptr);
+    glGenTextures(1, &renderer.g_depth);
+    glBindTexture(GL_TEXTURE_2D, renderer.g_depth);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D,
-                           renderer.g_norm, 0);
 
-    glGenTextures(1, &renderer.g_col);
-    glBindTexture(GL_TEXTURE_2D, renderer.g_col);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, 1600, 900, //@TODO screen sz
-                 0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, GL_TEXTURE_2D,
+    {   int fb_w, fb_h;
+        glfwGetFramebufferSize(glfw_window, &fb_w, &fb_h);
+        map_framebuffer_sz_cb({fb_w, fb_h});
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, renderer.g_buff);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
                            renderer.g_col, 0);
-
-    glGenRenderbuffers(1, &renderer.rbo);
-    glBindRenderbuffer(GL_RENDERBUFFER, renderer.rbo);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, 1600, 900); //@TODO screen sz
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
-                              GL_RENDERBUFFER, renderer.rbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D,
+                           renderer.g_depth, 0);
     if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
         LUX_FATAL("failed to create framebuffer for map deferred shading");
     }
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    glBindRenderbuffer(GL_RENDERBUFFER, 0);
 
     Arr<Renderer::Vert, 4> verts;
     for(Uns i = 0; i < 4; ++i) {
@@ -196,27 +1466,90 @@ void map_init() {
     renderer.i_buff.bind();
     renderer.i_buff.write(6, idxs, GL_STATIC_DRAW);
 
-    renderer.program = load_program("glsl/map_deferred.vert",
-                                    "glsl/map_deferred.frag");
+    renderer.program.init(program_ids.deferred);
+    renderer.program.use();
+    renderer.program.get_uniform<I32>("g_col").set(0);
+    renderer.program.get_uniform<I32>("g_depth").set(1);
+    uniforms.deferred_g_scale =
+        renderer.program.get_uniform<Vec2F>("g_scale");
     renderer.vert_fmt.init(
         {{2, GL_FLOAT, false, false},
          {2, GL_FLOAT, false, false}});
     renderer.context.init({renderer.v_buff}, renderer.vert_fmt);
 }
 
+///the chunk cache is kept per server, so it's opened once we are connected
+void map_set_server(Str const& server_name) {
+    disk_cache_init(server_name);
+}
+
+///reallocates the G-buffer storage, the attachments stay valid
+void map_framebuffer_sz_cb(Vec2U const& sz) {
+    //@NOTE a minimized window has a zero sized framebuffer
+    Vec2U g_buff_sz = glm::max(sz, Vec2U(1));
+    if(g_buff_sz == renderer.g_buff_sz) return;
+    renderer.g_buff_sz = g_buff_sz;
+    LUX_LOG("resizing G-buffer to %ux%u", g_buff_sz.x, g_buff_sz.y);
+    glBindTexture(GL_TEXTURE_2D, renderer.g_col);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, g_buff_sz.x, g_buff_sz.y,
+                 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindTexture(GL_TEXTURE_2D, renderer.g_depth);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24,
+                 g_buff_sz.x, g_buff_sz.y,
+                 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, nullptr);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
 void map_deinit() {
+    mesher_deinit();
     //@TODO destroy more stuff from renderer?
     renderer.context.deinit();
     renderer.i_buff.deinit();
     renderer.v_buff.deinit();
+    glDeleteVertexArrays(1, &pull_context);
+    glDeleteQueries(1, &dyn_res.query);
 
-    for(auto& mesh : meshes) {
+    for(Uns i = 0; i < meshes.len; ++i) {
+        Mesh& mesh = meshes[i];
         if(mesh.is_allocated) {
+            if(mesh.is_disk_dirty) {
+                mesh_write_disk_cache(mesh, get_fov_pos(i));
+            }
             mesh.dealloc();
         }
     }
     meshes.dealloc_all();
+    disk_cache_deinit();
     debug_mesh_0.dealloc();
+    arena_deinit();
+    quad_i_buff.deinit();
+}
+
+///reads back the timing of an earlier frame, the result is usually available
+///one or two frames later, so we never stall on it
+static void dyn_res_update() {
+    if(dyn_res.is_pending) {
+        GLuint is_available;
+        glGetQueryObjectuiv(dyn_res.query, GL_QUERY_RESULT_AVAILABLE,
+                            &is_available);
+        if(is_available) {
+            GLuint64 elapsed_ns;
+            glGetQueryObjectui64v(dyn_res.query, GL_QUERY_RESULT,
+                                  &elapsed_ns);
+            dyn_res.last_ms    = (F32)elapsed_ns / 1e6f;
+            dyn_res.is_pending = false;
+            if(dyn_res.is_enabled && dyn_res.last_ms > 0.f) {
+                //@NOTE the cost grows with the pixel count, that is with the
+                //square of the scale, we move only part of the way to damp
+                //the oscillations
+                F32 wanted = dyn_res.scale *
+                    glm::sqrt(dyn_res.target_ms / dyn_res.last_ms);
+                dyn_res.scale = glm::mix(dyn_res.scale, wanted, 0.25f);
+            }
+        }
+    }
+    if(not dyn_res.is_enabled) dyn_res.scale = 1.f;
+    dyn_res.scale = glm::clamp(dyn_res.scale, DYN_RES_MIN_SCALE, 1.f);
 }
 
 static void map_io_tick(U32, Transform const&, IoContext& context) {
@@ -281,61 +1614,64 @@ static void map_io_tick(U32, Transform const&, IoContext& context) {
     static ChkCoord last_render_dist = 0;
     ChkCoord last_mesh_load_size = 2 * last_render_dist + 1;
 
-    ChkPos chk_diff           = chk_pos - last_player_chk_pos;
-    ChkCoord render_dist_diff = render_dist - last_render_dist;
-    chk_diff -= render_dist_diff;
-    if(chk_diff != ChkPos(0)) {
-        //@XXX downsizing render distance crashed in the past
+    ChkPos chk_diff = chk_pos - last_player_chk_pos;
+    if(render_dist != last_render_dist) {
+        //@NOTE the grid size changed, so every chunk gets a new slot
         SizeT meshes_num = glm::pow(mesh_load_size, 3);
-        auto get_idx = [&](ChkPos pos, ChkCoord size) {
-            return pos.x +
-                   pos.y * size +
-                   pos.z * size * size;
-        };
-        //@TODO send unload signal to server
+        ChkPos last_min = last_player_chk_pos - last_render_dist;
+        ChkPos min      = chk_pos - render_dist;
         static DynArr<Mesh> new_meshes;
-        for(auto& mesh : new_meshes) { //@TODO temp workaround
-            if(mesh.is_allocated) {
-                mesh.dealloc();
+        new_meshes.clear();
+        new_meshes.resize(meshes_num);
+        for(Uns i = 0; i < meshes.len; ++i) {
+            if(not meshes[i].is_allocated) continue;
+            ChkPos pos = last_min + wrap_chk_pos(
+                get_grid_pos(i, last_mesh_load_size) - last_min,
+                last_mesh_load_size);
+            ChkPos rel_pos = pos - min;
+            if(clamp(rel_pos, ChkPos(0), ChkPos(mesh_load_size - 1)) !=
+               rel_pos) {
+                mesh_evict(meshes[i], pos);
+                continue;
             }
+            new_meshes[get_grid_idx(pos, mesh_load_size)] = move(meshes[i]);
         }
-        new_meshes.resize(meshes_num);
-        for(ChkCoord z =  chk_diff.z > 0 ? chk_diff.z : 0;
-                     z < (chk_diff.z < 0 ? chk_diff.z : 0) + last_mesh_load_size;
-                   ++z) {
-            for(ChkCoord y =  chk_diff.y > 0 ? chk_diff.y : 0;
-                         y < (chk_diff.y < 0 ? chk_diff.y : 0) + last_mesh_load_size;
-                       ++y) {
-                for(ChkCoord x =  chk_diff.x > 0 ? chk_diff.x : 0;
-                             x < (chk_diff.x < 0 ? chk_diff.x : 0) + last_mesh_load_size;
-                           ++x) {
-                    ChkPos src(x, y, z);
-                    SizeT src_idx = get_idx(src, last_mesh_load_size);
-                    ChkPos dst = src - chk_diff;
-                    SizeT dst_idx = get_idx(dst, mesh_load_size);
-                    if(src_idx >= meshes.len ||
-                       not meshes[src_idx].is_allocated) {
-                        if(dst_idx < new_meshes.len &&
-                           new_meshes[dst_idx].is_allocated) {
-                            new_meshes[dst_idx].dealloc();
-                        }
-                        continue;
-                    }
-                    if(dst_idx >= new_meshes.len) {
-                        if(meshes[src_idx].is_allocated) {
-                            meshes[src_idx].dealloc();
+        swap(meshes, new_meshes);
+    } else if(chk_diff != ChkPos(0)) {
+        //@NOTE the grid is indexed toroidally, so only the slabs that left
+        //the load volume are touched, their slots get reused by the chunks
+        //entering from the opposite side
+        //@TODO send unload signal to server
+        ChkPos last_min = last_player_chk_pos - render_dist;
+        ChkPos min      = chk_pos - render_dist;
+        for(Uns axis = 0; axis < 3; ++axis) {
+            ChkCoord slab_beg = chk_diff[axis] > 0 ? last_min[axis] :
+                max(min[axis] + mesh_load_size, last_min[axis]);
+            ChkCoord slab_end = chk_diff[axis] > 0 ?
+                glm::min(min[axis], last_min[axis] + mesh_load_size) :
+                last_min[axis] + mesh_load_size;
+            Uns u = (axis + 1) % 3;
+            Uns v = (axis + 2) % 3;
+            ChkPos pos;
+            for(pos[axis] = slab_beg; pos[axis] < slab_end; ++pos[axis]) {
+                for(pos[u] = last_min[u];
+                    pos[u] < last_min[u] + mesh_load_size; ++pos[u]) {
+                    for(pos[v] = last_min[v];
+                        pos[v] < last_min[v] + mesh_load_size; ++pos[v]) {
+                        Mesh& mesh = meshes[get_grid_idx(pos, mesh_load_size)];
+                        if(mesh.is_allocated) {
+                            mesh_evict(mesh, pos);
                         }
-                        continue;
                     }
-                    new_meshes[dst_idx] = move(meshes[src_idx]);
                 }
             }
         }
-        swap(meshes, new_meshes);
     }
 
     last_player_chk_pos = chk_pos;
     last_render_dist    = render_dist;
+    mesher_integrate();
+    map_flush_updates();
 
     glm::mat4 mvp =
         {1, 0, 0, 0,
@@ -348,6 +1684,7 @@ static void map_io_tick(U32, Transform const&, IoContext& context) {
     direction.z = glm::cos(prot.y) * glm::sin(-prot.x);
     direction = glm::normalize(direction);
 
+    Vec3F map_camera_pos = camera_pos;
     F32 temp = camera_pos.z;
     camera_pos.z = camera_pos.y;
     camera_pos.y = temp;
@@ -367,42 +1704,86 @@ static void map_io_tick(U32, Transform const&, IoContext& context) {
     };
     static DynArr<DrawData> draw_queue;
     draw_queue.clear();
+    cull_boxes.clear();
+    //@NOTE unloaded chunks which are out of view are requested after the
+    //visible ones
+    static DynArr<ChkPos> hidden_requests;
+    hidden_requests.clear();
+    chunk_requests.clear();
     struct {
         U64 chunks_num = 0;
         U64 real_chunks_num = 0;
         U64 trigs_num  = 0;
+        U64 draws_num  = 0;
+        U64 gpu_chunks_num = 0;
+        U64 occluded_chunks_num = 0;
+        U64 hw_occluded_chunks_num = 0;
+        U64 occl_queries_num = 0;
     } status;
-    for(Uns i = 0; i < meshes.len; ++i) {
+    if(dist_offs_render_dist != render_dist) {
+        build_dist_offs();
+    }
+    for(auto const& off : dist_offs) {
+        ChkPos pos = chk_pos + off;
+        Uns i = get_grid_idx(pos, mesh_load_size);
         Mesh* mesh = &meshes[i];
-        if(mesh->is_allocated && mesh->verts.len <= 0) continue;
-        ChkPos pos = { i % mesh_load_size,
-                      (i / mesh_load_size) % mesh_load_size,
-                       i / (mesh_load_size * mesh_load_size)};
-        pos -= render_dist;
-        pos += chk_pos;
-        if(glm::distance((Vec3F)chk_pos, (Vec3F)pos) > render_dist) {
+        if(mesh->is_allocated && mesh->job_id == 0 && not mesh->is_pulled &&
+           mesh->lod != get_chunk_lod(pos)) {
+            mesher_enqueue(*mesh, pos);
+        }
+        //@NOTE meshes restored from the cache are still revalidated when
+        //they skip the culling below, otherwise they would never be
+        if(mesh->is_allocated &&
+           (mesh->is_pulled ? mesh->faces.len : mesh->verts.len) <= 0) {
+            if(mesh->is_stale) hidden_requests.push(pos);
+            continue;
+        }
+        if(gpu_culling && mesh->is_allocated && not mesh->is_pulled) {
+            //@NOTE culled and drawn by glsl/chunk_cull.comp
+            if(mesh->is_stale) hidden_requests.push(pos);
+            status.gpu_chunks_num++;
+            continue;
+        }
+        //@NOTE unloaded chunks are culled with their full box, so that we
+        //only request the visible ones
+        Vec3<U8> box_min(0);
+        Vec3<U8> box_max(CHK_SIZE);
+        if(mesh->is_allocated) {
+            mesh_get_box(*mesh, box_min, box_max);
+        }
+        cull_boxes.push(i, pos, box_min, box_max);
+    }
+    Arr<Vec4F, 6> planes;
+    get_frustum_planes(mvp, planes);
+    cull_boxes.cull(planes);
+    static DynArr<U8> is_unoccluded;
+    if(occlusion_culling) {
+        find_visible_chunks(chk_pos, is_unoccluded);
+    }
+    for(Uns i = 0; i < cull_boxes.len; ++i) {
+        Mesh const& mesh = meshes[cull_boxes.mesh_idxs[i]];
+        bool is_loaded = mesh.is_allocated && not mesh.is_stale;
+        if(not cull_boxes.is_visible[i]) {
+            if(not is_loaded) hidden_requests.push((ChkPos)cull_boxes.poses[i]);
+            continue;
+        }
+        if(occlusion_culling && not is_unoccluded[cull_boxes.mesh_idxs[i]]) {
+            if(not is_loaded) hidden_requests.push((ChkPos)cull_boxes.poses[i]);
+            status.occluded_chunks_num++;
             continue;
         }
-        Vec3F center = (Vec3F)pos * (Vec3F)CHK_SIZE + (Vec3F)(CHK_SIZE / 2);
-        Vec4F c_center = mvp * Vec4F(center, 1.f);
-        c_center.x /= c_center.w;
-        c_center.y /= c_center.w;
-        F32 constexpr chk_rad = CHK_SIZE * glm::sqrt(3);
-        if(c_center.z < -chk_rad) continue;
-        F32 c_chk_rad = chk_rad / glm::abs(c_center.w);
-        if(glm::abs(c_center.x) > 1.f + c_chk_rad ||
-           glm::abs(c_center.y) > 1.f + c_chk_rad) continue;
-
         status.chunks_num++;
-        draw_queue.push({i, pos});
-    }
-    {
-        Vec3F f_pos = chk_pos;
-        std::sort(draw_queue.begin(), draw_queue.end(),
-            [&](DrawData const& a, DrawData const& b) {
-                return glm::fastDistance(a.pos, f_pos) <
-                       glm::fastDistance(b.pos, f_pos);
-            });
+        draw_queue.push({cull_boxes.mesh_idxs[i], cull_boxes.poses[i]});
+    }
+    //@NOTE restoring uploads the mesh, which changes the bound vertex array
+    //and buffer texture, so it has to happen before the map pass binds them
+    for(auto const& draw_data : draw_queue) {
+        Mesh& mesh = meshes[draw_data.mesh_idx];
+        if(not mesh.is_allocated) mesh_restore(mesh, (ChkPos)draw_data.pos);
+    }
+    for(auto const& pos : hidden_requests) {
+        Mesh& mesh = meshes[get_grid_idx(pos, mesh_load_size)];
+        if(not mesh.is_allocated) mesh_restore(mesh, pos);
     }
     static bool wireframe = false;
     if(wireframe) {
@@ -415,25 +1796,42 @@ static void map_io_tick(U32, Transform const&, IoContext& context) {
     //glClearColor(ambient_light.r, ambient_light.g, ambient_light.b, 1);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+    dyn_res_update();
+    Vec2U g_viewport_sz = glm::max(
+        Vec2U(Vec2F(renderer.g_buff_sz) * dyn_res.scale), Vec2U(1));
+    bool is_timing = not dyn_res.is_pending;
+    if(is_timing) glBeginQuery(GL_TIME_ELAPSED, dyn_res.query);
+
     //@TODO remove one of clear color
     glBindFramebuffer(GL_FRAMEBUFFER, renderer.g_buff);
+    glViewport(0, 0, g_viewport_sz.x, g_viewport_sz.y);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
     glEnable(GL_DEPTH_TEST);
     glCullFace(GL_FRONT);
     glEnable(GL_CULL_FACE);
-    glUseProgram(program);
-    set_uniform("tileset" , program, glUniform1i, 0);
+    {   FrameUniforms frame;
+        frame.mvp           = mvp;
+        frame.inv_mvp       = glm::inverse(mvp);
+        frame.ambient_light = Vec4F(ambient_light, 1.f);
+        frame.time          = glfwGetTime();
+        frame_uniforms_write(frame);
+    }
+    program.use();
     glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, tileset);
-    set_uniform("time", program, glUniform1f, glfwGetTime());
-    set_uniform("ambient_light", program, glUniform3fv,
-                1, glm::value_ptr(ambient_light));
-    set_uniform("mvp", program, glUniformMatrix4fv,
-                1, GL_FALSE, glm::value_ptr(mvp));
-    constexpr GLenum buffers[3] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1,
-        GL_COLOR_ATTACHMENT2};
-    glDrawBuffers(3, buffers);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, tileset);
+    GLuint current_program = program.id;
+    struct OcclData {
+        U32   mesh_idx;
+        Vec3F box_min;
+        Vec3F box_max;
+    };
+    static DynArr<OcclData> occl_queue;
+    occl_queue.clear();
+    static U64 occl_frames_num = 0;
+    ++occl_frames_num;
+    constexpr GLenum buffers[1] = {GL_COLOR_ATTACHMENT0};
+    glDrawBuffers(1, buffers);
 
     for(auto const& draw_data : draw_queue) {
         Mesh* mesh = &meshes[draw_data.mesh_idx];
@@ -442,23 +1840,156 @@ static void map_io_tick(U32, Transform const&, IoContext& context) {
             //@NOTE we request the chunk here, because we want to request them
             //in a priority sorted by distance to player, i.e. closer chunks
             //are requested earlier
-            chunk_requests.emplace(pos);
+            chunk_requests.push((ChkPos)pos);
             continue;
         }
+        if(mesh->is_stale) {
+            chunk_requests.push((ChkPos)pos);
+        }
+        if(occlusion_queries) {
+            Vec3F chk_translation = pos * (F32)CHK_SIZE;
+            Vec3<U8> mesh_box_min, mesh_box_max;
+            mesh_get_box(*mesh, mesh_box_min, mesh_box_max);
+            //@NOTE the box is grown by a block, a box lying on the chunk's own
+            //faces would fail the depth test against them, e.g. for a flat
+            //chunk, and the chunk would flicker
+            Vec3F box_min = chk_translation + (Vec3F)mesh_box_min - 1.f;
+            Vec3F box_max = chk_translation + (Vec3F)mesh_box_max + 1.f;
+            //@NOTE a chunk which wasn't queried in the last frame, e.g. one
+            //which was out of view, is drawn until a fresh result arrives,
+            //an old result would make it pop in
+            if(mesh->occl_frame + 1 != occl_frames_num) {
+                mesh->is_occluded     = false;
+                mesh->is_occl_pending = false;
+            }
+            //@NOTE the near plane would clip the box around the camera
+            if(clamp(map_camera_pos, box_min - 1.f, box_max + 1.f) ==
+               map_camera_pos) {
+                mesh->is_occluded = false;
+            } else {
+                occl_queue.push({draw_data.mesh_idx, box_min, box_max});
+                mesh->occl_frame = occl_frames_num;
+                if(mesh->is_occl_pending) {
+                    GLuint is_available;
+                    glGetQueryObjectuiv(mesh->occl_query,
+                        GL_QUERY_RESULT_AVAILABLE, &is_available);
+                    if(is_available) {
+                        GLuint samples_passed;
+                        glGetQueryObjectuiv(mesh->occl_query,
+                            GL_QUERY_RESULT, &samples_passed);
+                        mesh->is_occluded     = not samples_passed;
+                        mesh->is_occl_pending = false;
+                    }
+                }
+                if(mesh->is_occluded) {
+                    status.hw_occluded_chunks_num++;
+                    continue;
+                }
+            }
+        }
         if(mesh != &debug_mesh_0 && mesh != &debug_mesh_1) {
             status.real_chunks_num++;
         }
-        status.trigs_num += mesh->idxs.len / 3;
-        Vec3F chk_translation = pos * (F32)CHK_SIZE;
-
-        set_uniform("chk_pos", program, glUniform3fv, 1,
-            glm::value_ptr(chk_translation));
-        //@TODO multi draw
-        mesh->context.bind();
-        mesh->i_buff.bind();
-        glDrawElements(GL_TRIANGLES, mesh->idxs.len, GL_UNSIGNED_SHORT, 0);
+        if(mesh->is_pulled) {
+            Vec3F chk_translation = pos * (F32)CHK_SIZE;
+            if(current_program != pull_program.id) {
+                pull_program.use();
+                glBindVertexArray(pull_context);
+                glActiveTexture(GL_TEXTURE1);
+                current_program = pull_program.id;
+            }
+            uniforms.pull_chk_pos.set(chk_translation);
+            status.trigs_num += mesh->faces.len * 2;
+            status.draws_num++;
+            glBindTexture(GL_TEXTURE_BUFFER, mesh->faces_tex);
+            glDrawArrays(GL_TRIANGLES, 0, mesh->faces.len * 6);
+            continue;
+        }
+        status.trigs_num += mesh->verts.len / 2;
+        auto& arena = arenas[mesh->geom.arena];
+        arena.draw_counts.push((mesh->verts.len / 4) * 6);
+        arena.draw_offs.push(nullptr);
+        arena.draw_base_verts.push(mesh->geom.page * ARENA_PAGE_VERTS);
+    }
+    for(auto const& pos : hidden_requests) {
+        Mesh& mesh = meshes[get_grid_idx(pos, mesh_load_size)];
+        if(not mesh.is_allocated || mesh.is_stale) {
+            chunk_requests.push(pos);
+        }
+    }
+    if(gpu_culling) {
+        Vec3F f_chk_pos = chk_pos;
+        cull_program.use();
+        uniforms.cull_planes.set(&planes[0], 6);
+        uniforms.cull_cam_chk_pos.set(f_chk_pos);
+        uniforms.cull_render_dist.set((F32)render_dist);
+        for(auto& arena : arenas) {
+            U32 slots_num = arena_get_slots_num(arena);
+            if(slots_num == 0) continue;
+            uniforms.cull_slots_num.set(slots_num);
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, arena.chunks_buff.id);
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, arena.cmds_buff.id);
+            gl_ext.dispatch_compute((slots_num + 63) / 64, 1, 1);
+        }
+        gl_ext.memory_barrier(GL_COMMAND_BARRIER_BIT);
+    }
+    program.use();
+    glActiveTexture(GL_TEXTURE1);
+    for(auto& arena : arenas) {
+        U32 slots_num = gpu_culling ? arena_get_slots_num(arena) : 0;
+        if(slots_num > 0) {
+            arena.context.bind();
+            glBindTexture(GL_TEXTURE_BUFFER, arena.pages_tex);
+            arena.cmds_buff.bind(GL_DRAW_INDIRECT_BUFFER);
+            gl_ext.multi_draw_elements_indirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+                                                nullptr, slots_num, 0);
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+            status.draws_num++;
+        }
+        if(arena.draw_counts.len > 0) {
+            arena.context.bind();
+            glBindTexture(GL_TEXTURE_BUFFER, arena.pages_tex);
+            glMultiDrawElementsBaseVertex(GL_TRIANGLES, arena.draw_counts.beg,
+                GL_UNSIGNED_INT, arena.draw_offs.beg, arena.draw_counts.len,
+                arena.draw_base_verts.beg);
+            status.draws_num++;
+        }
+        arena.draw_counts.clear();
+        arena.draw_offs.clear();
+        arena.draw_base_verts.clear();
+    }
+    glActiveTexture(GL_TEXTURE0);
+    if(occl_queue.len > 0) {
+        //@NOTE the boxes are tested against the depth of this frame, the
+        //results decide which chunks are drawn in the next one
+        occl_program.use();
+        glBindVertexArray(pull_context);
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        glDepthMask(GL_FALSE);
+        glDisable(GL_CULL_FACE);
+        for(auto const& occl_data : occl_queue) {
+            Mesh& mesh = meshes[occl_data.mesh_idx];
+            if(mesh.is_occl_pending) continue;
+            uniforms.occl_box_min.set(occl_data.box_min);
+            uniforms.occl_box_max.set(occl_data.box_max);
+            glBeginQuery(GL_ANY_SAMPLES_PASSED, mesh.occl_query);
+            glDrawArrays(GL_TRIANGLE_STRIP, 0, 14);
+            glEndQuery(GL_ANY_SAMPLES_PASSED);
+            mesh.is_occl_pending = true;
+            status.occl_queries_num++;
+        }
+        glEnable(GL_CULL_FACE);
+        glDepthMask(GL_TRUE);
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    }
+    //@NOTE only the scaled G-buffer pass is timed, the deferred pass runs at
+    //the full resolution and doesn't change with the scale
+    if(is_timing) {
+        glEndQuery(GL_TIME_ELAPSED);
+        dyn_res.is_pending = true;
     }
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, renderer.g_buff_sz.x, renderer.g_buff_sz.y);
 
     glDisable(GL_DEPTH_TEST);
     if(wireframe) {
@@ -466,18 +1997,14 @@ static void map_io_tick(U32, Transform const&, IoContext& context) {
     }
 
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    glUseProgram(renderer.program);
-
-    set_uniform("g_pos" , renderer.program, glUniform1i, 0);
-    set_uniform("g_norm", renderer.program, glUniform1i, 1);
-    set_uniform("g_col" , renderer.program, glUniform1i, 2);
+    renderer.program.use();
+    uniforms.deferred_g_scale.set(
+        Vec2F(g_viewport_sz) / Vec2F(renderer.g_buff_sz));
 
     glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, renderer.g_pos);
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, renderer.g_norm);
-    glActiveTexture(GL_TEXTURE2);
     glBindTexture(GL_TEXTURE_2D, renderer.g_col);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, renderer.g_depth);
 
     renderer.context.bind();
     renderer.i_buff.bind();
@@ -486,8 +2013,9 @@ static void map_io_tick(U32, Transform const&, IoContext& context) {
     //@TODO is this needed?
     glBindFramebuffer(GL_READ_FRAMEBUFFER, renderer.g_buff);
     glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
-    glBlitFramebuffer(0, 0, 1600, 900, 0, 0, 1600, 900, GL_DEPTH_BUFFER_BIT,
-                      GL_NEAREST); //@TODO screen sz
+    glBlitFramebuffer(0, 0, g_viewport_sz.x, g_viewport_sz.y,
+                      0, 0, renderer.g_buff_sz.x, renderer.g_buff_sz.y,
+                      GL_DEPTH_BUFFER_BIT, GL_NEAREST);
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
     static F64 avg = 0.0;
@@ -524,31 +2052,80 @@ static void map_io_tick(U32, Transform const&, IoContext& context) {
     if(ImGui::Button("wireframe mode")) {
         wireframe = !wireframe;
     }
+    bool rebuild_meshes = false;
+    rebuild_meshes |= ImGui::Checkbox("greedy meshing", &greedy_meshing);
+    rebuild_meshes |= ImGui::Checkbox("vertex pulling", &vertex_pulling);
+    if(rebuild_meshes) {
+        for(Uns i = 0; i < meshes.len; ++i) {
+            if(not meshes[i].is_allocated) continue;
+            if(vertex_pulling) {
+                mesh_upload_faces(meshes[i]);
+            } else {
+                mesher_enqueue(meshes[i], get_fov_pos(i));
+            }
+        }
+    }
     ImGui::Text("fps: %d", (int)fps);
+    ImGui::Checkbox("dynamic resolution", &dyn_res.is_enabled);
+    ImGui::SliderFloat("target map time (ms)", &dyn_res.target_ms,
+                       1.f, 50.f);
+    ImGui::Text("map time: %.2F, resolution scale: %d%%",
+                dyn_res.last_ms, (int)(dyn_res.scale * 100.f));
     ImGui::Text("render dist: %zu", (Uns)render_dist);
-    ImGui::Text("pending chunks num: %zu", chunk_requests.size());
+    ImGui::Text("wanted chunks num: %zu", chunk_requests.len);
+    ImGui::SliderInt("chunk cache budget (MiB)",
+                     &chunk_cache.budget_mb, 0, 512);
+    chunk_cache_shrink();
+    ImGui::Text("chunk cache: %zu chunks, %zuKiB, %zu hits",
+                chunk_cache.entries.size(), chunk_cache.size / 1024,
+                chunk_cache.hits_num);
+    ImGui::Text("disk chunk cache hits: %zu", disk_cache_hits_num);
     ImGui::Text("chunks num: %zu", status.chunks_num);
     ImGui::Text("real chunks num: %zu", status.real_chunks_num);
+    ImGui::Checkbox("occlusion culling", &occlusion_culling);
+    ImGui::Text("occluded chunks num: %zu", status.occluded_chunks_num);
+    ImGui::Checkbox("occlusion queries", &occlusion_queries);
+    ImGui::Checkbox("level of detail", &lod_enabled);
+    ImGui::SliderInt("lod distance", &lod_dist, 1, 32);
+    ImGui::Text("occlusion queries num: %zu", status.occl_queries_num);
+    ImGui::Text("query occluded chunks num: %zu",
+                status.hw_occluded_chunks_num);
     ImGui::Text("trigs num: %zu", status.trigs_num);
+    ImGui::Text("draws num: %zu", status.draws_num);
+    ImGui::Text("geometry arenas num: %zu", arenas.len);
+    if(gl_ext.has_compute) {
+        ImGui::Checkbox("gpu culling", &gpu_culling);
+        ImGui::Text("gpu culled chunks num: %zu", status.gpu_chunks_num);
+    } else {
+        ImGui::Text("gpu culling unsupported");
+    }
     ImGui::End();
 }
 
+static ChkPos get_fov_pos(Uns idx) {
+    ChkCoord size = render_dist * 2 + 1;
+    ChkPos   min  = last_player_chk_pos - render_dist;
+    return min + wrap_chk_pos(get_grid_pos(idx, size) - min, size);
+}
+
 ///returns -1 if out of bounds
 static Int get_fov_idx(ChkPos const& pos) {
-    ChkPos idx_pos = (pos - last_player_chk_pos) + render_dist;
+    ChkPos rel_pos = (pos - last_player_chk_pos) + render_dist;
     ChkCoord size = render_dist * 2 + 1;
-    if(clamp(idx_pos, ChkPos(0), ChkPos(size)) != idx_pos) return -1;
-    Int idx = idx_pos.x + idx_pos.y * size + idx_pos.z * size * size;
-    return idx;
+    if(clamp(rel_pos, ChkPos(0), ChkPos(size - 1)) != rel_pos) return -1;
+    return get_grid_idx(pos, size);
+}
+
+bool map_is_chunk_wanted(ChkPos const& pos) {
+    Int idx = get_fov_idx(pos);
+    return idx >= 0 && (Uns)idx < meshes.len &&
+           (not meshes[idx].is_allocated || meshes[idx].is_stale);
 }
 
 void map_load_chunks(NetSsSgnl::ChunkLoad const& net_chunks) {
     gl::VertContext::unbind_all();
     for(auto const& pair : net_chunks.chunks) {
         ChkPos chk_pos = pair.first;
-        if(chunk_requests.count(chk_pos) > 0) {
-            chunk_requests.erase(chk_pos);
-        }
         auto const& net_chunk = pair.second;
         Int idx = get_fov_idx(chk_pos);
         if(idx < 0) {
@@ -556,51 +2133,42 @@ void map_load_chunks(NetSsSgnl::ChunkLoad const& net_chunks) {
                 chk_pos.x, chk_pos.y, chk_pos.z);
             continue;
         }
-        if(meshes[idx].is_allocated) {
+        Mesh& mesh = meshes[idx];
+        if(mesh.is_allocated && not mesh.is_stale) {
             LUX_LOG_WARN("received chunk {%zd, %zd, %zd} alread loaded",
                 chk_pos.x, chk_pos.y, chk_pos.z);
             continue;
         }
-        Mesh& mesh = meshes[idx];
-        SizeT faces_num = 0;
-        faces_num += net_chunk.faces.len;
-        mesh.verts.resize(faces_num * 4);
-        mesh.idxs.resize(faces_num * 6);
-        Arr<Vec3<U8>, 3 * 4> vert_offs = {
-            {0, 0, 0}, {0, 1, 0}, {0, 0, 1}, {0, 1, 1},
-            {0, 0, 0}, {0, 0, 1}, {1, 0, 0}, {1, 0, 1},
-            {0, 0, 0}, {1, 0, 0}, {0, 1, 0}, {1, 1, 0},
-        };
+        static DynArr<MeshFace> faces;
+        faces.resize(net_chunk.faces.len);
         for(Uns i = 0; i < net_chunk.faces.len; ++i) {
             auto const& n_face = net_chunk.faces[i];
-            ChkIdx idx = n_face.idx;
-            U8 axis = (n_face.orientation & 0b110) >> 1;
-            LUX_ASSERT(axis != 0b11);
-            U8 sign = (n_face.orientation & 1);
-            Vec3<U8> face_off(0);
-            face_off[axis] = 1;
-            if(sign) {
-                for(Uns j = 0; j < 6; ++j) {
-                    mesh.idxs[i * 6 + j] = quad_idxs<U16>[j] + i * 4;
-                }
-            } else {
-                for(Uns j = 0; j < 6; ++j) {
-                    mesh.idxs[i * 6 + j] = quad_idxs<U16>[5 - j] + i * 4;
-                }
+            faces[i] = {n_face.idx, n_face.orientation, n_face.id};
+        }
+        static DynArr<U32> records;
+        pack_faces(records, faces);
+        U64 hash = disk_cache_hash(records);
+        if(mesh.is_allocated) {
+            mesh.is_stale = false;
+            if(hash == mesh.faces_hash) {
+                //@NOTE the cached chunk is up to date
+                continue;
             }
-            for(Uns j = 0; j < 4; ++j) {
-                auto& vert = mesh.verts[i * 4 + j];
-                vert.pos  = (Vec3<U8>)to_idx_pos(idx) + face_off +
-                    vert_offs[axis * 4 + j];
-                vert.norm = n_face.orientation;
-                vert.tex  = n_face.id;
+            //@NOTE we keep drawing the cached mesh until the new one is built
+            swap(mesh.faces, faces);
+            mesh_update_box(mesh);
+            if(mesh.is_pulled) {
+                mesh_upload_faces(mesh);
+            } else {
+                mesher_enqueue(mesh, chk_pos);
             }
+        } else {
+            mesh.alloc();
+            swap(mesh.faces, faces);
+            mesh_load(mesh, chk_pos);
         }
-        mesh.alloc();
-        mesh.v_buff.bind();
-        mesh.v_buff.write(mesh.verts.len, mesh.verts.beg, GL_DYNAMIC_DRAW);
-        mesh.i_buff.bind();
-        mesh.i_buff.write(mesh.idxs.len, mesh.idxs.beg, GL_DYNAMIC_DRAW);
+        mesh.faces_hash = hash;
+        disk_cache_write(chk_pos, records, hash);
     }
 }
 
@@ -612,57 +2180,85 @@ void map_update_chunks(NetSsSgnl::ChunkUpdate const& net_chunks) {
         LUX_LOG("updating chunk {%zd, %zd, %zd}", pos.x, pos.y, pos.z);
         Int idx = get_fov_idx(pos);
         if(idx < 0 || not meshes[idx].is_allocated) {
+            //@NOTE the server doesn't know that we evicted the chunk, so the
+            //cached copy gets outdated
+            chunk_cache_erase(pos);
             LUX_LOG_WARN("received chunk update for unloaded chunk"
                 " {%zd, %zd, %zd}", pos.x, pos.y, pos.z);
             continue;
         }
         Mesh& mesh = meshes[idx];
+        mesh.is_disk_dirty = true;
         for(auto const& removed_face : net_chunk.removed_faces) {
-            for(Uns i = (removed_face + 1) * 6; i < mesh.idxs.len; ++i) {
-                mesh.idxs[i] -= 4;
-            }
-            //@XXX this crashed in the past
-            mesh.idxs.erase(removed_face * 6, 6);
-            mesh.verts.erase(removed_face * 4, 4);
-        }
-        Arr<Vec3<U8>, 3 * 4> vert_offs = {
-            {0, 0, 0}, {0, 1, 0}, {0, 0, 1}, {0, 1, 1},
-            {0, 0, 0}, {0, 0, 1}, {1, 0, 0}, {1, 0, 1},
-            {0, 0, 0}, {1, 0, 0}, {0, 1, 0}, {1, 1, 0},
-        };
-        Uns off = mesh.verts.len / 4;
-        mesh.idxs.resize(mesh.idxs.len + net_chunk.added_faces.len * 6);
-        mesh.verts.resize(mesh.verts.len + net_chunk.added_faces.len * 4);
+            mesh.faces.erase(removed_face, 1);
+        }
+        Uns faces_off = mesh.faces.len;
+        mesh.faces.resize(mesh.faces.len + net_chunk.added_faces.len);
         for(Uns i = 0; i < net_chunk.added_faces.len; ++i) {
             auto const& n_face = net_chunk.added_faces[i];
-            ChkIdx idx = n_face.idx;
-            U8 axis = (n_face.orientation & 0b110) >> 1;
-            LUX_ASSERT(axis != 0b11);
-            U8 sign = (n_face.orientation & 1);
-            Vec3<U8> face_off(0);
-            face_off[axis] = 1;
-            if(sign) {
-                for(Uns j = 0; j < 6; ++j) {
-                    mesh.idxs[off * 6 + j] = quad_idxs<U16>[j] + off * 4;
-                }
-            } else {
-                for(Uns j = 0; j < 6; ++j) {
-                    mesh.idxs[off * 6 + j] = quad_idxs<U16>[5 - j] + off * 4;
-                }
+            mesh.faces[faces_off + i] =
+                {n_face.idx, n_face.orientation, n_face.id};
+        }
+        //@NOTE the GPU side is updated once per frame in map_flush_updates,
+        //so that several updates of one chunk don't upload it several times
+        pending_updates.emplace(pos);
+        if(mesh.job_id != 0 || mesh.is_greedy || mesh.lod > 0 ||
+           mesh.is_pulled) {
+            continue;
+        }
+        for(auto const& removed_face : net_chunk.removed_faces) {
+            U32 quad = mesh.quad_slots[removed_face];
+            mesh.quad_slots.erase(removed_face, 1);
+            //@NOTE a quad with all its verts in one place has no area, so it
+            //doesn't get rasterized
+            for(Uns i = 1; i < 4; ++i) {
+                mesh.verts[quad * 4 + i] = mesh.verts[quad * 4];
             }
-            for(Uns j = 0; j < 4; ++j) {
-                auto& vert = mesh.verts[off * 4 + j];
-                vert.pos  = (Vec3<U8>)to_idx_pos(idx) + face_off +
-                    vert_offs[axis * 4 + j];
-                vert.norm = n_face.orientation;
-                vert.tex  = n_face.id;
+            mesh.free_quads.push(quad);
+            mesh.dirty_quads.push(quad);
+        }
+        for(Uns i = 0; i < net_chunk.added_faces.len; ++i) {
+            U32 quad;
+            if(mesh.free_quads.len > 0) {
+                quad = mesh.free_quads[mesh.free_quads.len - 1];
+                mesh.free_quads.erase(mesh.free_quads.len - 1, 1);
+            } else {
+                quad = mesh.verts.len / 4;
+                mesh.verts.resize(mesh.verts.len + 4);
             }
-            ++off;
+            build_face(mesh.verts.beg + quad * 4, mesh.faces[faces_off + i]);
+            mesh.quad_slots.push(quad);
+            mesh.dirty_quads.push(quad);
         }
-        mesh.i_buff.bind();
-        mesh.i_buff.write(mesh.idxs.len, mesh.idxs.beg, GL_DYNAMIC_DRAW);
-        mesh.v_buff.bind();
-        mesh.v_buff.write(mesh.verts.len, mesh.verts.beg, GL_DYNAMIC_DRAW);
     }
 }
 
+static void map_flush_updates() {
+    if(pending_updates.size() == 0) return;
+    gl::VertContext::unbind_all();
+    for(auto const& pos : pending_updates) {
+        Int idx = get_fov_idx(pos);
+        //@NOTE the chunk might have been unloaded since
+        if(idx < 0 || not meshes[idx].is_allocated) continue;
+        Mesh& mesh = meshes[idx];
+        mesh_update_box(mesh);
+        if(mesh.job_id != 0 || mesh.is_greedy || mesh.lod > 0) {
+            //@NOTE the mesh is still being built or its quads don't match the
+            //faces, so we rebuild it from the updated faces instead
+            mesher_enqueue(mesh, pos);
+        } else if(mesh.is_pulled) {
+            mesh_upload_faces(mesh);
+        } else if(mesh.free_quads.len * 2 > mesh.verts.len / 4) {
+            //@NOTE too many holes, we compact the mesh to not draw them
+            build_mesh(mesh.verts, mesh.faces);
+            reset_quad_slots(mesh);
+            mesh_upload_verts(mesh, pos);
+            build_side_links(mesh.side_links, mesh.faces);
+        } else {
+            mesh_upload_quads(mesh, pos, mesh.dirty_quads);
+            mesh.dirty_quads.clear();
+            build_side_links(mesh.side_links, mesh.faces);
+        }
+    }
+    pending_updates.clear();
+}
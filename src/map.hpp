@@ -1,5 +1,7 @@
 #pragma once
 
+#include <functional>
+//
 #include <glad/glad.h>
 //
 #include <lux_shared/map.hpp>
@@ -7,8 +9,23 @@
 //
 #include <db.hpp>
 
-extern VecSet<ChkPos> chunk_requests;
+struct ChkPosHash {
+    SizeT operator()(ChkPos const& pos) const {
+        return std::hash<ChkCoord>()(pos.x) ^
+              (std::hash<ChkCoord>()(pos.y) << 1) ^
+              (std::hash<ChkCoord>()(pos.z) << 2);
+    }
+};
+
+///unloaded chunks in load range, in the order they should be requested
+extern DynArr<ChkPos> chunk_requests;
 
+void map_preload();
+void map_start_programs();
 void map_init();
+void map_set_server(Str const& server_name);
+void map_deinit();
+void map_framebuffer_sz_cb(Vec2U const& sz);
+bool map_is_chunk_wanted(ChkPos const& pos);
 void map_load_chunks(NetSsSgnl::ChunkLoad const& net_chunks);
 void map_update_chunks(NetSsSgnl::ChunkUpdate const& net_chunks);
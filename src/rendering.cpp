@@ -1,6 +1,18 @@
+#if defined(LUX_OS_UNIX)
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+#endif
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
 #include <cstring>
 #include <vector>
+#include <thread>
 #include <fstream>
+#include <type_traits>
+#include <initializer_list>
 //
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
@@ -12,9 +24,24 @@
 //
 #include <lux_shared/common.hpp>
 //
+#include <assets.hpp>
 #include <rendering.hpp>
 
 GLFWwindow* glfw_window;
+GlExt       gl_ext;
+static GLuint frame_ubo;
+///hash of the driver, the cached program binaries are only valid for it
+static U64    driver_hash = 0xcbf29ce484222325;
+
+static U64 hash_bytes(U64 hash, void const* data, SizeT len) {
+    ///FNV-1a
+    U8 const* bytes = (U8 const*)data;
+    for(SizeT i = 0; i < len; ++i) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3;
+    }
+    return hash;
+}
 
 static void glfw_error_cb(int err, char const* desc) {
     LUX_FATAL("GLFW error: %d - %s", err, desc);
@@ -41,7 +68,7 @@ void rendering_init() {
         glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
         glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
         glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-        glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+        glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
 
         glfw_window = glfwCreateWindow(WINDOW_SIZE.x, WINDOW_SIZE.y,
             "Lux", nullptr, nullptr);
@@ -59,14 +86,91 @@ void rendering_init() {
             LUX_FATAL("couldn't initialize GLAD");
         }
     }
+
+    { ///GL extensions
+        glGetIntegerv(GL_MAJOR_VERSION, &gl_ext.major);
+        glGetIntegerv(GL_MINOR_VERSION, &gl_ext.minor);
+        LUX_LOG("OpenGL %d.%d, %s", gl_ext.major, gl_ext.minor,
+                (char const*)glGetString(GL_RENDERER));
+        auto load = [](auto& fun, char const* name) {
+            fun = (std::remove_reference_t<decltype(fun)>)
+                glfwGetProcAddress(name);
+            return fun != nullptr;
+        };
+        if(gl_ext.major > 4 || (gl_ext.major == 4 && gl_ext.minor >= 3)) {
+            gl_ext.has_compute =
+                load(gl_ext.dispatch_compute, "glDispatchCompute") &&
+                load(gl_ext.memory_barrier  , "glMemoryBarrier") &&
+                load(gl_ext.multi_draw_elements_indirect,
+                     "glMultiDrawElementsIndirect");
+        }
+        if(not gl_ext.has_compute) {
+            LUX_LOG("compute shaders unavailable");
+        }
+        auto has_ext = [](char const* name) {
+            GLint exts_num;
+            glGetIntegerv(GL_NUM_EXTENSIONS, &exts_num);
+            for(GLint i = 0; i < exts_num; ++i) {
+                auto ext = (char const*)glGetStringi(GL_EXTENSIONS, i);
+                if(std::strcmp(ext, name) == 0) return true;
+            }
+            return false;
+        };
+        if(gl_ext.major > 4 || (gl_ext.major == 4 && gl_ext.minor >= 1) ||
+           has_ext("GL_ARB_get_program_binary")) {
+            GLint formats_num = 0;
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats_num);
+            gl_ext.has_program_binary = formats_num > 0 &&
+                load(gl_ext.get_program_binary, "glGetProgramBinary") &&
+                load(gl_ext.program_binary    , "glProgramBinary") &&
+                load(gl_ext.program_parameteri, "glProgramParameteri");
+        }
+        if(not gl_ext.has_program_binary) {
+            LUX_LOG("program binaries unavailable, shaders won't be cached");
+        }
+        if(has_ext("GL_KHR_parallel_shader_compile")) {
+            gl_ext.has_parallel_compile = load(
+                gl_ext.max_shader_compiler_threads,
+                "glMaxShaderCompilerThreadsKHR");
+        } else if(has_ext("GL_ARB_parallel_shader_compile")) {
+            gl_ext.has_parallel_compile = load(
+                gl_ext.max_shader_compiler_threads,
+                "glMaxShaderCompilerThreadsARB");
+        }
+        if(gl_ext.has_parallel_compile) {
+            ///let the driver pick the number of threads
+            gl_ext.max_shader_compiler_threads(0xffffffff);
+        }
+
+        for(GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+            auto str = (char const*)glGetString(name);
+            driver_hash = hash_bytes(driver_hash, str, std::strlen(str));
+        }
+    }
     glViewport(0, 0, WINDOW_SIZE.x, WINDOW_SIZE.y);
     glfwSetInputMode(glfw_window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+
+    glGenBuffers(1, &frame_ubo);
+    glBindBuffer(GL_UNIFORM_BUFFER, frame_ubo);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameUniforms), nullptr,
+                 GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_UNIFORMS_BINDING, frame_ubo);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
 }
 
 void rendering_deinit() {
+    glDeleteBuffers(1, &frame_ubo);
     glfwTerminate();
 }
 
+void frame_uniforms_write(FrameUniforms const& uniforms) {
+    static_assert(sizeof(FrameUniforms) == 160,
+                  "FrameUniforms doesn't match the std140 layout");
+    glBindBuffer(GL_UNIFORM_BUFFER, frame_ubo);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameUniforms), &uniforms);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
 void check_opengl_error()
 {
     GLenum error = glGetError();
@@ -85,89 +189,220 @@ void check_opengl_error()
     }
 }
 
-GLuint load_shader(GLenum type, char const* path) {
-    GLuint id = glCreateShader(type);
+///reads the source and prepends the version directive, unless the shader
+///declares its own
+static void read_shader(char const* path, DynArr<char>& src) {
     char constexpr VERSION_DIRECTIVE[] = "#version 330 core\n";
     constexpr SizeT VERSION_LEN = sizeof(VERSION_DIRECTIVE) - 1;
-    char* str;
-    {   std::ifstream file(path);
-        file.seekg(0, file.end);
-        long len = file.tellg();
-        if(len == -1) {
-            LUX_FATAL("failed to load shader: %s", path);
-        }
-        file.seekg(0, file.beg);
-
-        str = lux_alloc<char>((SizeT)len + VERSION_LEN + 1);
-        LUX_DEFER { lux_free(str); };
-        std::memcpy(str, VERSION_DIRECTIVE, VERSION_LEN);
-        file.read(str + VERSION_LEN, len);
-        file.close();
-        str[(SizeT)len + VERSION_LEN] = '\0';
-        glShaderSource(id, 1, &str, nullptr);
-        glCompileShader(id);
+    std::vector<U8> file;
+    if(not asset_take_file(path, file)) {
+        LUX_FATAL("failed to load shader: %s", path);
     }
-
-    {   int success;
-        glGetShaderiv(id, GL_COMPILE_STATUS, &success);
-        if(!success) {
-            static constexpr SizeT OPENGL_LOG_SIZE = 512;
-            char log[OPENGL_LOG_SIZE];
-            glGetShaderInfoLog(id, OPENGL_LOG_SIZE, nullptr, log);
-            LUX_FATAL("shader %s compilation error: \n%s", path, log);
-        }
+    SizeT len = file.size();
+
+    src.resize(len + VERSION_LEN + 1);
+    std::memcpy(src.beg, VERSION_DIRECTIVE, VERSION_LEN);
+    std::memcpy(src.beg + VERSION_LEN, file.data(), len);
+    src[len + VERSION_LEN] = '\0';
+    ///shaders needing a newer GLSL version declare it themselves
+    if(std::strncmp(src.beg + VERSION_LEN, "#version", 8) == 0) {
+        std::memmove(src.beg, src.beg + VERSION_LEN, len + 1);
+        src.resize(len + 1);
     }
-    return id;
 }
 
-GLuint load_program(char const* vert_path, char const* frag_path) {
-    //@TODO geometry shader support
-    GLuint vert_id = load_shader(GL_VERTEX_SHADER  , vert_path);
-    GLuint frag_id = load_shader(GL_FRAGMENT_SHADER, frag_path);
+///programs whose compilation was started, but not checked yet, checking the
+///status blocks, so it's deferred until the program is first needed
+struct PendingProgram {
+    GLuint      id;
+    U64         hash;
+    SizeT       shaders_num;
+    GLuint      shaders[3];
+    ///only used for the error messages, the callers pass string literals
+    char const* paths[3];
+};
+static DynArr<PendingProgram> pending_programs;
+
+static void get_program_cache_path(U64 hash, char* path, SizeT len) {
+    std::snprintf(path, len, "shader_cache/%016llx.bin",
+                  (unsigned long long)hash);
+}
 
-    GLuint id = glCreateProgram();
-    glAttachShader(id, vert_id);
-    glAttachShader(id, frag_id);
-    glLinkProgram(id);
-    glDeleteShader(vert_id);
-    glDeleteShader(frag_id);
+static bool load_program_binary(GLuint id, U64 hash) {
+    char path[64];
+    get_program_cache_path(hash, path, sizeof(path));
+    std::ifstream file(path, std::ios::binary);
+    if(not file.is_open()) return false;
+    GLenum format;
+    file.read((char*)&format, sizeof(format));
+    file.seekg(0, file.end);
+    long len = (long)file.tellg() - (long)sizeof(format);
+    if(not file.good() || len <= 0) return false;
+    DynArr<U8> binary;
+    binary.resize(len);
+    file.seekg(sizeof(format), file.beg);
+    file.read((char*)binary.beg, len);
+    if(not file.good()) return false;
+    gl_ext.program_binary(id, format, binary.beg, len);
+    //@NOTE the driver can reject binaries, e.g. after being updated without
+    //changing its version string, we compile the sources then
+    int success;
+    glGetProgramiv(id, GL_LINK_STATUS, &success);
+    return success;
+}
 
-    {   int success;
-        glGetProgramiv(id, GL_LINK_STATUS, &success);
-        if(!success) {
-            static constexpr SizeT OPENGL_LOG_SIZE = 512;
-            char log[OPENGL_LOG_SIZE];
-            glGetProgramInfoLog(id, OPENGL_LOG_SIZE, nullptr, log);
-            LUX_FATAL("program linking error: \n%s", log);
-        }
+static void save_program_binary(GLuint id, U64 hash) {
+#if defined(LUX_OS_UNIX)
+    if(mkdir("shader_cache", 0755) != 0 && errno != EEXIST) {
+        LUX_LOG_WARN("failed to create shader cache directory: %s",
+                     std::strerror(errno));
+        return;
+    }
+#endif
+    GLint len;
+    glGetProgramiv(id, GL_PROGRAM_BINARY_LENGTH, &len);
+    if(len <= 0) return;
+    DynArr<U8> binary;
+    binary.resize(len);
+    GLenum format;
+    gl_ext.get_program_binary(id, len, &len, &format, binary.beg);
+    char path[64];
+    get_program_cache_path(hash, path, sizeof(path));
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write((char const*)&format, sizeof(format));
+    file.write((char const*)binary.beg, len);
+    if(not file.good()) {
+        LUX_LOG_WARN("failed to write shader cache file %s", path);
     }
-    return id;
 }
 
-GLuint load_program(char const* vert_path, char const* frag_path, char const* geom_path) {
-    GLuint vert_id = load_shader(GL_VERTEX_SHADER  , vert_path);
-    GLuint frag_id = load_shader(GL_FRAGMENT_SHADER, frag_path);
-    GLuint geom_id = load_shader(GL_GEOMETRY_SHADER, geom_path);
+///starts building a program, either from the binary cache or from the
+///sources, the status is checked by finish_program
+static GLuint start_program(SizeT shaders_num, GLenum const* types,
+                            char const* const* paths) {
+    LUX_ASSERT(shaders_num <= 3);
+    static DynArr<char> srcs[3];
+    U64 hash = driver_hash;
+    for(SizeT i = 0; i < shaders_num; ++i) {
+        read_shader(paths[i], srcs[i]);
+        hash = hash_bytes(hash, &types[i], sizeof(types[i]));
+        hash = hash_bytes(hash, srcs[i].beg, srcs[i].len);
+    }
 
     GLuint id = glCreateProgram();
-    glAttachShader(id, vert_id);
-    glAttachShader(id, frag_id);
-    glAttachShader(id, geom_id);
+    if(gl_ext.has_program_binary) {
+        if(load_program_binary(id, hash)) return id;
+        gl_ext.program_parameteri(id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT,
+                                  GL_TRUE);
+    }
+    PendingProgram pending;
+    pending.id          = id;
+    pending.hash        = hash;
+    pending.shaders_num = shaders_num;
+    for(SizeT i = 0; i < shaders_num; ++i) {
+        GLuint shader_id = glCreateShader(types[i]);
+        char const* src = srcs[i].beg;
+        glShaderSource(shader_id, 1, &src, nullptr);
+        glCompileShader(shader_id);
+        glAttachShader(id, shader_id);
+        pending.shaders[i] = shader_id;
+        pending.paths[i]   = paths[i];
+    }
+    //@NOTE with KHR_parallel_shader_compile this returns right away and the
+    //driver compiles on its own threads
     glLinkProgram(id);
-    glDeleteShader(vert_id);
-    glDeleteShader(frag_id);
-    glDeleteShader(geom_id);
+    pending_programs.push(pending);
+    return id;
+}
 
+///without KHR_parallel_shader_compile the status can't be polled, checking
+///it just blocks
+static bool is_program_complete(GLuint id) {
+    if(not gl_ext.has_parallel_compile) return true;
+    GLint is_complete;
+    glGetProgramiv(id, GL_COMPLETION_STATUS_KHR, &is_complete);
+    return is_complete;
+}
+
+static void check_program(PendingProgram const& pending) {
+    GLuint id = pending.id;
+    static constexpr SizeT OPENGL_LOG_SIZE = 512;
+    char log[OPENGL_LOG_SIZE];
+    for(SizeT i = 0; i < pending.shaders_num; ++i) {
+        int success;
+        glGetShaderiv(pending.shaders[i], GL_COMPILE_STATUS, &success);
+        if(!success) {
+            glGetShaderInfoLog(pending.shaders[i], OPENGL_LOG_SIZE,
+                               nullptr, log);
+            LUX_FATAL("shader %s compilation error: \n%s",
+                      pending.paths[i], log);
+        }
+    }
     {   int success;
         glGetProgramiv(id, GL_LINK_STATUS, &success);
         if(!success) {
-            static constexpr SizeT OPENGL_LOG_SIZE = 512;
-            char log[OPENGL_LOG_SIZE];
             glGetProgramInfoLog(id, OPENGL_LOG_SIZE, nullptr, log);
             LUX_FATAL("program linking error: \n%s", log);
         }
     }
-    return id;
+    for(SizeT i = 0; i < pending.shaders_num; ++i) {
+        glDetachShader(id, pending.shaders[i]);
+        glDeleteShader(pending.shaders[i]);
+    }
+    if(gl_ext.has_program_binary) {
+        save_program_binary(id, pending.hash);
+    }
+}
+
+void finish_program(GLuint id) {
+    auto find_pending = [&]() {
+        SizeT idx = 0;
+        while(idx < pending_programs.len && pending_programs[idx].id != id) {
+            ++idx;
+        }
+        return idx;
+    };
+    ///programs loaded from the cache are already checked
+    if(find_pending() >= pending_programs.len) return;
+    while(not is_program_complete(id)) {
+        //@NOTE we check the programs which are done in the meantime, so that
+        //saving their binaries overlaps with the compilation of the rest
+        SizeT i = 0;
+        while(i < pending_programs.len) {
+            PendingProgram pending = pending_programs[i];
+            if(pending.id == id || not is_program_complete(pending.id)) {
+                ++i;
+                continue;
+            }
+            pending_programs.erase(i, 1);
+            check_program(pending);
+        }
+        std::this_thread::yield();
+    }
+    SizeT idx = find_pending();
+    PendingProgram pending = pending_programs[idx];
+    pending_programs.erase(idx, 1);
+    check_program(pending);
+}
+
+GLuint load_program(char const* vert_path, char const* frag_path) {
+    GLenum const types[2] = {GL_VERTEX_SHADER, GL_FRAGMENT_SHADER};
+    char const* paths[2]  = {vert_path, frag_path};
+    return start_program(2, types, paths);
+}
+
+GLuint load_program(char const* vert_path, char const* frag_path, char const* geom_path) {
+    GLenum const types[3] =
+        {GL_VERTEX_SHADER, GL_FRAGMENT_SHADER, GL_GEOMETRY_SHADER};
+    char const* paths[3]  = {vert_path, frag_path, geom_path};
+    return start_program(3, types, paths);
+}
+
+GLuint load_compute_program(char const* comp_path) {
+    LUX_ASSERT(gl_ext.has_compute);
+    GLenum const types[1] = {GL_COMPUTE_SHADER};
+    char const* paths[1]  = {comp_path};
+    return start_program(1, types, paths);
 }
 
 GLuint load_texture(char const* path, Vec2U& size_out) {
@@ -175,12 +410,10 @@ GLuint load_texture(char const* path, Vec2U& size_out) {
     glGenTextures(1, &id);
     glBindTexture(GL_TEXTURE_2D, id);
 
-    Vec2<unsigned> size;
     std::vector<U8> img;
-    {   auto err = lodepng::decode(img, size.x, size.y, path);
-        if(err) LUX_FATAL("couldn't load texture: %s", path);
+    if(not asset_take_png(path, img, size_out)) {
+        LUX_FATAL("couldn't load texture: %s", path);
     }
-    size_out = size;
 
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, size_out.x, size_out.y,
                  0, GL_RGBA, GL_UNSIGNED_BYTE, img.data());
@@ -193,6 +426,203 @@ GLuint load_texture(char const* path, Vec2U& size_out) {
     return id;
 }
 
+///the layers are cached with their mip chains, so that they can be uploaded
+///straight from a mapped file, without decoding the PNG
+struct TexArrayHeader {
+    U32 magic;
+    U32 version;
+    U64 src_hash;
+    U32 tile_w;
+    U32 tile_h;
+    U32 layers_num;
+    U32 levels_num;
+};
+U32 constexpr TEX_ARRAY_MAGIC   = 0x4154584c; ///"LXTA"
+U32 constexpr TEX_ARRAY_VERSION = 1;
+
+static SizeT get_tex_array_len(TexArrayHeader const& header) {
+    SizeT len = 0;
+    Vec2U sz = {header.tile_w, header.tile_h};
+    for(U32 i = 0; i < header.levels_num; ++i) {
+        len += sz.x * sz.y * header.layers_num * 4;
+        sz = glm::max(sz / 2u, Vec2U(1));
+    }
+    return len;
+}
+
+static void upload_tex_array(TexArrayHeader const& header, U8 const* data) {
+    Vec2U sz = {header.tile_w, header.tile_h};
+    for(U32 i = 0; i < header.levels_num; ++i) {
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, i, GL_RGBA8,
+                     sz.x, sz.y, header.layers_num,
+                     0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+        data += sz.x * sz.y * header.layers_num * 4;
+        sz = glm::max(sz / 2u, Vec2U(1));
+    }
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL,
+                    header.levels_num - 1);
+}
+
+///returns false if the cache is missing or outdated
+static bool load_tex_array_cache(char const* cache_path,
+                                 TexArrayHeader const& wanted) {
+    TexArrayHeader const* header;
+#if defined(LUX_OS_UNIX)
+    int fd = open(cache_path, O_RDONLY);
+    if(fd < 0) return false;
+    LUX_DEFER { close(fd); };
+    struct stat st;
+    if(fstat(fd, &st) != 0 || (SizeT)st.st_size < sizeof(TexArrayHeader)) {
+        return false;
+    }
+    SizeT file_len = st.st_size;
+    void* map = mmap(nullptr, file_len, PROT_READ, MAP_PRIVATE, fd, 0);
+    if(map == MAP_FAILED) return false;
+    LUX_DEFER { munmap(map, file_len); };
+    header = (TexArrayHeader const*)map;
+#else
+    DynArr<U8> file_data;
+    {   std::ifstream file(cache_path, std::ios::binary);
+        if(not file.is_open()) return false;
+        file.seekg(0, file.end);
+        long len = file.tellg();
+        if(len < (long)sizeof(TexArrayHeader)) return false;
+        file.seekg(0, file.beg);
+        file_data.resize(len);
+        file.read((char*)file_data.beg, len);
+        if(not file.good()) return false;
+    }
+    SizeT file_len = file_data.len;
+    header = (TexArrayHeader const*)file_data.beg;
+#endif
+    if(header->magic   != TEX_ARRAY_MAGIC   ||
+       header->version != TEX_ARRAY_VERSION ||
+       header->src_hash != wanted.src_hash  ||
+       header->tile_w  != wanted.tile_w     ||
+       header->tile_h  != wanted.tile_h     ||
+       file_len != sizeof(TexArrayHeader) + get_tex_array_len(*header)) {
+        return false;
+    }
+    upload_tex_array(*header, (U8 const*)(header + 1));
+    return true;
+}
+
+///averages 2x2 texels of every layer, odd edges are clamped
+static void build_mip_level(U8 const* src, Vec2U const& src_sz,
+                            U8* dst, Vec2U const& dst_sz, U32 layers_num) {
+    for(U32 l = 0; l < layers_num; ++l) {
+        U8 const* src_layer = src + l * src_sz.x * src_sz.y * 4;
+        U8*       dst_layer = dst + l * dst_sz.x * dst_sz.y * 4;
+        for(U32 y = 0; y < dst_sz.y; ++y) {
+            for(U32 x = 0; x < dst_sz.x; ++x) {
+                U32 x0 = glm::min(x * 2    , src_sz.x - 1);
+                U32 x1 = glm::min(x * 2 + 1, src_sz.x - 1);
+                U32 y0 = glm::min(y * 2    , src_sz.y - 1);
+                U32 y1 = glm::min(y * 2 + 1, src_sz.y - 1);
+                for(U32 c = 0; c < 4; ++c) {
+                    U32 sum = src_layer[(x0 + y0 * src_sz.x) * 4 + c] +
+                              src_layer[(x1 + y0 * src_sz.x) * 4 + c] +
+                              src_layer[(x0 + y1 * src_sz.x) * 4 + c] +
+                              src_layer[(x1 + y1 * src_sz.x) * 4 + c];
+                    dst_layer[(x + y * dst_sz.x) * 4 + c] = (sum + 2) / 4;
+                }
+            }
+        }
+    }
+}
+
+GLuint load_texture_array(char const* path, Vec2U const& tile_sz,
+                          U32& layers_num_out) {
+    GLuint id;
+    glGenTextures(1, &id);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, id);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER,
+                    GL_NEAREST_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    std::vector<U8> png;
+    if(not asset_take_file(path, png)) {
+        LUX_FATAL("couldn't load texture: %s", path);
+    }
+    TexArrayHeader header;
+    header.magic    = TEX_ARRAY_MAGIC;
+    header.version  = TEX_ARRAY_VERSION;
+    header.src_hash = hash_bytes(0xcbf29ce484222325, png.data(), png.size());
+    header.tile_w   = tile_sz.x;
+    header.tile_h   = tile_sz.y;
+
+    char cache_path[256];
+    {   char const* name = std::strrchr(path, '/');
+        name = name == nullptr ? path : name + 1;
+        std::snprintf(cache_path, sizeof(cache_path),
+                      "texture_cache/%s.bin", name);
+    }
+    if(load_tex_array_cache(cache_path, header)) {
+        GLint layers_num;
+        glGetTexLevelParameteriv(GL_TEXTURE_2D_ARRAY, 0, GL_TEXTURE_DEPTH,
+                                 &layers_num);
+        layers_num_out = layers_num;
+        return id;
+    }
+
+    LUX_LOG("building texture array cache for %s", path);
+    Vec2<unsigned> size;
+    std::vector<U8> img;
+    {   auto err = lodepng::decode(img, size.x, size.y, png);
+        if(err) LUX_FATAL("couldn't load texture: %s", path);
+    }
+    Vec2U tiles_num = Vec2U(size) / tile_sz;
+    if(tiles_num.x == 0 || tiles_num.y == 0) {
+        LUX_FATAL("texture %s is smaller than a tile", path);
+    }
+    header.layers_num = tiles_num.x * tiles_num.y;
+    header.levels_num =
+        (U32)std::log2((F32)glm::max(tile_sz.x, tile_sz.y)) + 1;
+
+    DynArr<U8> data;
+    data.resize(get_tex_array_len(header));
+    ///the tiles are laid out row by row, that's the layer index
+    for(U32 l = 0; l < header.layers_num; ++l) {
+        Vec2U tile_pos = Vec2U(l % tiles_num.x, l / tiles_num.x) * tile_sz;
+        for(U32 y = 0; y < tile_sz.y; ++y) {
+            std::memcpy(data.beg + (l * tile_sz.y + y) * tile_sz.x * 4,
+                        img.data() + ((tile_pos.y + y) * size.x +
+                                      tile_pos.x) * 4,
+                        tile_sz.x * 4);
+        }
+    }
+    {   U8*   level    = data.beg;
+        Vec2U level_sz = tile_sz;
+        for(U32 i = 1; i < header.levels_num; ++i) {
+            U8*   next    = level + level_sz.x * level_sz.y *
+                                    header.layers_num * 4;
+            Vec2U next_sz = glm::max(level_sz / 2u, Vec2U(1));
+            build_mip_level(level, level_sz, next, next_sz, header.layers_num);
+            level    = next;
+            level_sz = next_sz;
+        }
+    }
+    upload_tex_array(header, data.beg);
+    layers_num_out = header.layers_num;
+
+#if defined(LUX_OS_UNIX)
+    if(mkdir("texture_cache", 0755) != 0 && errno != EEXIST) {
+        LUX_LOG_WARN("failed to create texture cache directory: %s",
+                     std::strerror(errno));
+        return id;
+    }
+#endif
+    std::ofstream file(cache_path, std::ios::binary | std::ios::trunc);
+    file.write((char const*)&header, sizeof(header));
+    file.write((char const*)data.beg, data.len);
+    if(not file.good()) {
+        LUX_LOG_WARN("failed to write texture cache file %s", cache_path);
+    }
+    return id;
+}
+
 //@TODO more abstractions + above
 namespace gl {
 
@@ -242,4 +672,46 @@ void VertContext::unbind_all() {
     glBindVertexArray(0);
 }
 
+void Program::init(GLuint _id) {
+    id = _id;
+    finish_program(id);
+    GLint uniforms_num;
+    glGetProgramiv(id, GL_ACTIVE_UNIFORMS, &uniforms_num);
+    uniforms.resize(uniforms_num);
+    for(Int i = 0; i < uniforms_num; ++i) {
+        auto& uniform = uniforms[i];
+        GLint  size;
+        GLenum type;
+        glGetActiveUniform(id, i, sizeof(uniform.name), nullptr,
+                           &size, &type, uniform.name);
+        ///block members have no location, they are set through the buffer
+        uniform.loc = glGetUniformLocation(id, uniform.name);
+        ///arrays are reported as "name[0]", we look them up by the bare name
+        char* bracket = std::strchr(uniform.name, '[');
+        if(bracket != nullptr) *bracket = '\0';
+    }
+    GLuint frame_idx = glGetUniformBlockIndex(id, "Frame");
+    if(frame_idx != GL_INVALID_INDEX) {
+        glUniformBlockBinding(id, frame_idx, FRAME_UNIFORMS_BINDING);
+    }
+}
+
+void Program::deinit() {
+    glDeleteProgram(id);
+    uniforms.clear();
+}
+
+void Program::use() const {
+    glUseProgram(id);
+}
+
+GLint Program::get_loc(char const* name) const {
+    for(auto const& uniform : uniforms) {
+        if(std::strcmp(uniform.name, name) == 0) return uniform.loc;
+    }
+    //@NOTE the linker drops unused uniforms, so this isn't an error
+    LUX_LOG_WARN("uniform %s is not active in program %u", name, id);
+    return -1;
+}
+
 }
@@ -2,29 +2,96 @@
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
+#include <glm/mat4x4.hpp>
 //
 #include <lux_shared/common.hpp>
 
 extern GLFWwindow* glfw_window;
 
+//@NOTE our glad loader only covers the GL 3.3 core profile, so the newer
+//entry points we use are loaded at runtime and stay null when the context
+//doesn't provide them
+#ifndef GL_COMPUTE_SHADER
+    #define GL_COMPUTE_SHADER         0x91B9
+#endif
+#ifndef GL_SHADER_STORAGE_BUFFER
+    #define GL_SHADER_STORAGE_BUFFER  0x90D2
+#endif
+#ifndef GL_DRAW_INDIRECT_BUFFER
+    #define GL_DRAW_INDIRECT_BUFFER   0x8F3F
+#endif
+#ifndef GL_COMMAND_BARRIER_BIT
+    #define GL_COMMAND_BARRIER_BIT    0x00000040
+#endif
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+    #define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+    #define GL_PROGRAM_BINARY_LENGTH  0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+    #define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+#ifndef GL_COMPLETION_STATUS_KHR
+    #define GL_COMPLETION_STATUS_KHR  0x91B1
+#endif
+
+struct GlExt {
+    GLint major;
+    GLint minor;
+    ///GL 4.3, compute shaders, shader storage buffers and indirect draws
+    bool has_compute = false;
+    void (APIENTRYP dispatch_compute)(GLuint, GLuint, GLuint) = nullptr;
+    void (APIENTRYP memory_barrier)(GLbitfield) = nullptr;
+    void (APIENTRYP multi_draw_elements_indirect)
+        (GLenum, GLenum, void const*, GLsizei, GLsizei) = nullptr;
+    ///GL 4.1 or ARB_get_program_binary, used for the shader cache
+    bool has_program_binary = false;
+    void (APIENTRYP get_program_binary)
+        (GLuint, GLsizei, GLsizei*, GLenum*, void*) = nullptr;
+    void (APIENTRYP program_binary)
+        (GLuint, GLenum, void const*, GLsizei) = nullptr;
+    void (APIENTRYP program_parameteri)(GLuint, GLenum, GLint) = nullptr;
+    ///KHR_parallel_shader_compile
+    bool has_parallel_compile = false;
+    void (APIENTRYP max_shader_compiler_threads)(GLuint) = nullptr;
+};
+extern GlExt gl_ext;
+
 Vec2U get_window_size();
 Vec2D get_mouse_pos();
 
 void check_opengl_error();
-GLuint load_shader(GLenum type, char const* path);
+///the loaders only start the compilation, every module starts its programs
+///in its *_start_programs, before any module initializes, so that the driver
+///can compile all of them in parallel, linked programs are cached in
+///shader_cache/
 GLuint load_program(char const* vert_path, char const* frag_path);
 GLuint load_program(char const* vert_path, char const* frag_path, char const* geom_path);
+GLuint load_compute_program(char const* comp_path);
+///waits for the program and checks its status, called by gl::Program::init,
+///other programs completed in the meantime are checked while waiting
+void finish_program(GLuint id);
 GLuint load_texture(char const* path, Vec2U& size_out);
+///splits the image into tiles, one layer per tile in row order, the layers
+///and their mipmaps are cached in texture_cache/
+GLuint load_texture_array(char const* path, Vec2U const& tile_sz,
+                          U32& layers_num_out);
 
-template<typename F, typename... Args>
-void set_uniform(char const* name, GLuint program_id,
-                 F const& gl_fun, Args const &...args) {
-    //@TODO optimize, we don't need to retrieve the loc every time
-    gl_fun(glGetUniformLocation(program_id, name), args...);
-}
+///frame-constant data, shared by every program that declares the std140
+///Frame uniform block, the layout has to match the block in the shaders
+struct FrameUniforms {
+    glm::mat4 mvp;
+    glm::mat4 inv_mvp;
+    Vec4F     ambient_light;
+    F32       time;
+    F32       pad0[3];
+};
+GLuint constexpr FRAME_UNIFORMS_BINDING = 0;
 
 void rendering_init();
 void rendering_deinit();
+void frame_uniforms_write(FrameUniforms const& uniforms);
 
 namespace gl {
 //@CONSIDER m4 macros for generating VertFmt and Vert struct
@@ -88,6 +155,67 @@ struct VertContext {
     VertFmt  const* vert_fmt;
 };
 
+///a typed uniform location, setting an inactive uniform is a no-op
+template<typename T>
+struct Uniform {
+    void set(T const& val) const;
+    void set(T const* vals, SizeT len) const;
+    GLint loc = -1;
+};
+
+///a linked program, whose active uniforms are reflected once, so that the
+///locations never have to be looked up by name while rendering
+struct Program {
+    void init(GLuint _id);
+    void deinit();
+    void use() const;
+    template<typename T>
+    Uniform<T> get_uniform(char const* name) const;
+    GLint get_loc(char const* name) const;
+    struct ActiveUniform {
+        char  name[64];
+        GLint loc;
+    };
+    GLuint                id = 0;
+    DynArr<ActiveUniform> uniforms;
+};
+
+template<typename T>
+Uniform<T> Program::get_uniform(char const* name) const {
+    Uniform<T> uniform;
+    uniform.loc = get_loc(name);
+    return uniform;
+}
+
+template<> inline void Uniform<F32>::set(F32 const& val) const {
+    glUniform1f(loc, val);
+}
+template<> inline void Uniform<I32>::set(I32 const& val) const {
+    glUniform1i(loc, val);
+}
+template<> inline void Uniform<U32>::set(U32 const& val) const {
+    glUniform1ui(loc, val);
+}
+template<> inline void Uniform<Vec2F>::set(Vec2F const& val) const {
+    glUniform2fv(loc, 1, &val.x);
+}
+template<> inline void Uniform<Vec3F>::set(Vec3F const& val) const {
+    glUniform3fv(loc, 1, &val.x);
+}
+template<> inline void Uniform<Vec4F>::set(Vec4F const& val) const {
+    glUniform4fv(loc, 1, &val.x);
+}
+template<> inline void Uniform<glm::mat4>::set(glm::mat4 const& val) const {
+    glUniformMatrix4fv(loc, 1, GL_FALSE, &val[0][0]);
+}
+template<> inline void Uniform<I32>::set(I32 const* vals, SizeT len) const {
+    glUniform1iv(loc, len, vals);
+}
+template<> inline void Uniform<Vec4F>::set(Vec4F const* vals,
+                                           SizeT len) const {
+    glUniform4fv(loc, len, &vals[0].x);
+}
+
 template<typename T>
 void Buff::write(GLenum target, SizeT len, T const* data, GLenum usage) {
     glBufferData(target, sizeof(T) * len, data, usage);
@@ -2,10 +2,10 @@
 #include <cstring>
 //
 #include <glad/glad.h>
-#include <glm/gtc/type_ptr.hpp>
 //
 #include <lux_shared/common.hpp>
 //
+#include <assets.hpp>
 #include <rendering.hpp>
 #include <ui.hpp>
 #include <client.hpp>
@@ -72,7 +72,8 @@ struct TextSystem {
     };
 #pragma pack(pop)
 
-    GLuint      program;
+    gl::Program program;
+    GLuint      program_id;
     GLuint      font_texture;
     gl::VertFmt vert_fmt;
 } static text_system;
@@ -111,7 +112,8 @@ struct PaneSystem {
     };
 #pragma pack(pop)
 
-    GLuint program;
+    gl::Program program;
+    GLuint      program_id;
     gl::VertFmt vert_fmt;
 } static pane_system;
 
@@ -158,15 +160,30 @@ void ui_window_sz_cb(Vec2U const& old_sz, Vec2U const& sz) {
                              (F32)sz.y / (F32)sz.x);
 }
 
+void ui_preload() {
+    asset_preload("font.png"      , true);
+    asset_preload("glsl/text.vert", false);
+    asset_preload("glsl/text.frag", false);
+    asset_preload("glsl/pane.vert", false);
+    asset_preload("glsl/pane.frag", false);
+}
+
+void ui_start_programs() {
+    text_system.program_id =
+        load_program("glsl/text.vert", "glsl/text.frag");
+    pane_system.program_id =
+        load_program("glsl/pane.vert", "glsl/pane.frag");
+}
+
 void ui_init() {
     char const* font_path = "font.png";
-    text_system.program = load_program("glsl/text.vert", "glsl/text.frag");
+    text_system.program.init(text_system.program_id);
     Vec2U font_size;
     text_system.font_texture = load_texture(font_path, font_size);
     Vec2F font_pos_scale = Vec2F(8.f, 8.f) / (Vec2F)font_size;
-    glUseProgram(text_system.program);
-    set_uniform("font_pos_scale", text_system.program,
-                glUniform2fv, 1, glm::value_ptr(font_pos_scale));
+    text_system.program.use();
+    text_system.program.get_uniform<Vec2F>("font_pos_scale")
+        .set(font_pos_scale);
 
     text_system.vert_fmt.init({
         {2, GL_FLOAT        , false, false},
@@ -174,7 +191,7 @@ void ui_init() {
         {4, GL_UNSIGNED_BYTE, true , false},
         {4, GL_UNSIGNED_BYTE, true , false}});
 
-    pane_system.program = load_program("glsl/pane.vert", "glsl/pane.frag");
+    pane_system.program.init(pane_system.program_id);
 
     pane_system.vert_fmt.init({
         {2, GL_FLOAT, false, false},
@@ -290,7 +307,7 @@ static void text_io_tick(U32 id, Transform const& tr, IoContext&) {
     text.i_buff.bind();
     text.i_buff.write(quad_len * 6, idxs.beg, GL_DYNAMIC_DRAW);
 
-    glUseProgram(text_system.program);
+    text_system.program.use();
     glBindTexture(GL_TEXTURE_2D, text_system.font_texture);
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
@@ -314,7 +331,7 @@ static void pane_io_tick(U32 id, Transform const& tr, IoContext&) {
     pane.v_buff.write(4, verts, GL_DYNAMIC_DRAW);
     pane.i_buff.bind();
     pane.i_buff.write(6, idxs, GL_DYNAMIC_DRAW);
-    glUseProgram(pane_system.program);
+    pane_system.program.use();
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
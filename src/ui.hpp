@@ -87,6 +87,8 @@ UiTextId ui_text_create(UiId parent, Transform const& tr, Str const& str);
 UiPaneId ui_pane_create(UiId parent, Transform const& tr, Vec4F const& bg_col);
 
 void ui_window_sz_cb(Vec2U const& old_window_sz, Vec2U const& window_sz);
+void ui_preload();
+void ui_start_programs();
 void ui_init();
 void ui_deinit();
 void ui_io_tick();